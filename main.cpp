@@ -10,9 +10,41 @@ Author: Subhajit Halder
 #include <fstream>
 #include <string>
 #include <cstdlib>
+#include <cstdio>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <stdexcept>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+
+// POSIX systems get background saves (fork) and lazy loading (mmap)
+#if defined(__unix__) || defined(__APPLE__)
+#define PERSONDB_POSIX 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// SSE2 filter and aggregate kernels for SELECT (scalar loops otherwise)
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
+// sourceOffset of a lazily loaded person whose fields could not be read back
+const long long RECORD_UNREADABLE = -2;
+
 // Structure to store all personal information
 struct Person {
     string lastName;      // last name
@@ -25,6 +57,8 @@ struct Person {
     string password;      // Acc PWD
     double balance;       // Acc Bal
     string ssn;           // Social Security Number
+    long long sourceOffset; // Data file offset of fields not parsed yet (-1 when complete,
+                            // RECORD_UNREADABLE if parsing them failed)
     
     // Constructor to create Person from data tokens
     Person(string last, string first, string st, string zip, 
@@ -39,80 +73,116 @@ struct Person {
         password = pwd;
         balance = bal;
         ssn = social;
+        sourceOffset = -1;
     }
+};
+
+// Custom case-sensitive string comparison (-1, 0 or 1 like strcmp)
+inline int compareStrings(const string& str1, const string& str2) {
+    // Compare character by character (case-sensitive)
+    size_t minLength = str1.length();
+    if (str2.length() < minLength) minLength = str2.length();
     
-    // case-sensitive string comparison
-    int compareStrings(const string& str1, const string& str2) const {
-        // Compare character by character (case-sensitive)
-        size_t minLength = str1.length();
-        if (str2.length() < minLength) minLength = str2.length();
-        
-        for (size_t i = 0; i < minLength; i++) {
-            if (str1[i] != str2[i]) {
-                if (str1[i] < str2[i]) return -1;
-                else return 1;
-            }
+    for (size_t i = 0; i < minLength; i++) {
+        if (str1[i] != str2[i]) {
+            if (str1[i] < str2[i]) return -1;
+            else return 1;
         }
-        
-        // If common characters match, shorter string comes first
-        if (str1.length() < str2.length()) return -1;
-        if (str1.length() > str2.length()) return 1;
-        
-        return 0; // Strings are equal
     }
     
-    // Compare two persons by last name, then first name using comparison
-    bool isLessThan(const Person& other) const {
-        // First compare last names using custom comparison
-        int lastCompare = compareStrings(lastName, other.lastName);
-        if (lastCompare < 0) return true;
-        if (lastCompare > 0) return false;
-        
-        // If last names match, compare first names using comparison
-        int firstCompare = compareStrings(firstName, other.firstName);
-        return firstCompare < 0;
+    // If common characters match, shorter string comes first
+    if (str1.length() < str2.length()) return -1;
+    if (str1.length() > str2.length()) return 1;
+    
+    return 0; // Strings are equal
+}
+
+// Node of a non-intrusive index - the index allocates it and keeps a copy of the value
+template <class Value>
+struct IndexNode {
+    Value data;           // The value stored in this node
+    IndexNode* left;      // Pointer to left child node
+    IndexNode* right;     // Pointer to right child node
+    int height;           // Height of node for balancing
+    
+    // Constructor to create new tree node
+    IndexNode(const Value& v) : data(v), left(nullptr), right(nullptr), height(1) {}
+};
+
+// Allocator tag for intrusive indexes - the value itself has left, right and height
+// members and is owned by the caller, so the index never allocates or frees it
+struct IntrusiveNodes {};
+
+// Node policy for non-intrusive indexes - nodes come from the (rebound) allocator
+template <class Value, class Alloc>
+struct IndexNodeTraits {
+    typedef IndexNode<Value> Node;
+    typedef typename allocator_traits<Alloc>::template rebind_alloc<Node> NodeAlloc;
+    typedef allocator_traits<NodeAlloc> AllocTraits;
+    
+    static Value& value(Node* node) { return node->data; }
+    
+    static Node* create(NodeAlloc& alloc, const Value& v) {
+        Node* node = AllocTraits::allocate(alloc, 1);
+        AllocTraits::construct(alloc, node, v);
+        return node;
     }
     
-    // Check if two persons are identical using comparison
-    bool isEqualTo(const Person& other) const {
-        int lastCompare = compareStrings(lastName, other.lastName);
-        if (lastCompare != 0) return false;
-        
-        int firstCompare = compareStrings(firstName, other.firstName);
-        return firstCompare == 0;
+    static void destroy(NodeAlloc& alloc, Node* node) {
+        AllocTraits::destroy(alloc, node);
+        AllocTraits::deallocate(alloc, node, 1);
     }
 };
 
-// Tree node structure for binary search tree
-struct TreeNode {
-    Person data;          // The person data stored in this node
-    TreeNode* left;       // Pointer to left child node
-    TreeNode* right;      // Pointer to right child node
-    int height;           // Height of node for balancing
+// Node policy for intrusive indexes - the value is the node
+template <class Value>
+struct IndexNodeTraits<Value, IntrusiveNodes> {
+    typedef Value Node;
+    typedef IntrusiveNodes NodeAlloc;
     
-    // Constructor to create new tree node
-    TreeNode(Person p) : data(p), left(nullptr), right(nullptr), height(1) {}
+    static Value& value(Node* node) { return *node; }
+    
+    // Unlinked values still belong to the caller
+    static void destroy(NodeAlloc&, Node*) {}
 };
 
-// Main database class that manages all operations
-class PersonDatabase {
+// AVL tree ordered by Compare(KeyOf(value)). KeyOf and Compare are function objects
+// taken as template arguments so every comparison is inlined into the tree code.
+//   KeyOf:   Key operator()(const Value&) const
+//   Compare: int operator()(const Key&, const Key&) const  (-1, 0 or 1)
+//   Alloc:   allocator for nodes, or IntrusiveNodes to link caller-owned values
+template <class Key, class Value, class KeyOf, class Compare, class Alloc = allocator<Value> >
+class OrderedIndex {
+public:
+    typedef IndexNodeTraits<Value, Alloc> Traits;
+    typedef typename Traits::Node Node;
+
 private:
-    TreeNode* root;  // Root node of our binary search tree
+    Node* rootNode;                       // Root node of the tree
+    size_t nodeCount;                     // Number of linked nodes
+    typename Traits::NodeAlloc nodeAlloc; // Source of nodes (non-intrusive mode)
+    KeyOf keyOf;                          // Extracts the key from a value
+    Compare compare;                      // Three-way key comparison
+    
+    // Compare a key with the key of a node
+    int compareTo(const Key& key, Node* node) const {
+        return compare(key, keyOf(Traits::value(node)));
+    }
     
     // Get height of a node (returns 0 for null nodes)
-    int getNodeHeight(TreeNode* node) {
+    static int getNodeHeight(Node* node) {
         if (node == nullptr) return 0;
         return node->height;
     }
     
     // Calculate balance factor (left height - right height)
-    int getBalanceFactor(TreeNode* node) {
+    static int getBalanceFactor(Node* node) {
         if (node == nullptr) return 0;
         return getNodeHeight(node->left) - getNodeHeight(node->right);
     }
     
     // Update height of node based on children's heights
-    void updateNodeHeight(TreeNode* node) {
+    static void updateNodeHeight(Node* node) {
         if (node == nullptr) return;
         
         int leftHeight = getNodeHeight(node->left);
@@ -126,13 +196,13 @@ private:
     }
     
     // Rotate subtree right to fix left-heavy imbalance
-    TreeNode* rotateRight(TreeNode* y) {
+    static Node* rotateRight(Node* y) {
         if (y == nullptr) return nullptr;
         
-        TreeNode* x = y->left;
+        Node* x = y->left;
         if (x == nullptr) return y;
         
-        TreeNode* T2 = x->right;
+        Node* T2 = x->right;
         
         // Perform rotation
         x->right = y;
@@ -146,13 +216,13 @@ private:
     }
     
     // Rotate subtree left to fix right-heavy imbalance  
-    TreeNode* rotateLeft(TreeNode* x) {
+    static Node* rotateLeft(Node* x) {
         if (x == nullptr) return nullptr;
         
-        TreeNode* y = x->right;
+        Node* y = x->right;
         if (y == nullptr) return x;
         
-        TreeNode* T2 = y->left;
+        Node* T2 = y->left;
         
         // Perform rotation
         y->left = x;
@@ -166,7 +236,7 @@ private:
     }
     
     // Balance a node after insertion or deletion
-    TreeNode* balanceNode(TreeNode* node) {
+    static Node* balanceNode(Node* node) {
         if (node == nullptr) return nullptr;
         
         // Update height of current node
@@ -201,20 +271,22 @@ private:
         return node;
     }
     
-    // Insert a new person into the tree
-    TreeNode* insertPerson(TreeNode* node, const Person& p) {
-        // Found empty spot - create new node here
+    // Link a fresh node into the tree (linked is false if its key already exists)
+    Node* insertNode(Node* node, Node* fresh, bool& linked) {
+        // Found empty spot - place the new node here
         if (node == nullptr) {
-            return new TreeNode(p);
+            linked = true;
+            return fresh;
         }
         
-        // Compare to decide left or right subtree using custom comparison
-        if (p.isLessThan(node->data)) {
-            node->left = insertPerson(node->left, p);
-        } else if (node->data.isLessThan(p)) {
-            node->right = insertPerson(node->right, p);
+        // Compare to decide left or right subtree
+        int cmp = compareTo(keyOf(Traits::value(fresh)), node);
+        if (cmp < 0) {
+            node->left = insertNode(node->left, fresh, linked);
+        } else if (cmp > 0) {
+            node->right = insertNode(node->right, fresh, linked);
         } else {
-            // Person already exists - no duplicates allowed
+            // Key already exists - no duplicates allowed
             return node;
         }
         
@@ -222,134 +294,1271 @@ private:
         return balanceNode(node);
     }
     
-    // Custom case-sensitive string comparison for search operations
-    int compareStrings(const string& str1, const string& str2) const {
-        // Compare character by character (case-sensitive)
-        size_t minLength = str1.length();
-        if (str2.length() < minLength) minLength = str2.length();
+    // Find the node with a key in a subtree
+    Node* findNode(Node* node, const Key& key) const {
+        if (node == nullptr) return nullptr;  // Key not found
         
-        for (size_t i = 0; i < minLength; i++) {
-            if (str1[i] != str2[i]) {
-                if (str1[i] < str2[i]) return -1;
-                else return 1;
-            }
+        int cmp = compareTo(key, node);
+        if (cmp < 0) return findNode(node->left, key);
+        if (cmp > 0) return findNode(node->right, key);
+        return node;
+    }
+    
+    // Detach the smallest node (leftmost node) of a subtree
+    static Node* detachSmallest(Node* node, Node*& smallest) {
+        if (node->left == nullptr) {
+            smallest = node;
+            return node->right;
         }
+        node->left = detachSmallest(node->left, smallest);
+        return balanceNode(node);
+    }
+    
+    // Unlink the node with a key from a subtree (removed is set to it, if found).
+    // Nodes are relinked rather than having their contents copied, so every node
+    // other than the removed one keeps its value and its address.
+    Node* unlinkNode(Node* node, const Key& key, Node*& removed) {
+        if (node == nullptr) return nullptr;
         
-        // If common characters match, shorter string comes first
-        if (str1.length() < str2.length()) return -1;
-        if (str1.length() > str2.length()) return 1;
+        // Search for the node to unlink
+        int cmp = compareTo(key, node);
+        if (cmp < 0) {
+            node->left = unlinkNode(node->left, key, removed);
+        } else if (cmp > 0) {
+            node->right = unlinkNode(node->right, key, removed);
+        } else {
+            removed = node;
+            
+            // Case 1: Node has no children or one child - the child takes its place
+            if (node->left == nullptr) return node->right;
+            if (node->right == nullptr) return node->left;
+            
+            // Case 2: Node has two children - the smallest node of the right subtree takes its place
+            Node* successor = nullptr;
+            Node* rest = detachSmallest(node->right, successor);
+            successor->left = node->left;
+            successor->right = rest;
+            node = successor;
+        }
         
-        return 0; // Strings are equal
+        // Balance the tree after deletion
+        return balanceNode(node);
     }
     
-    // Find a specific person in the tree using custom comparison
-    TreeNode* findPerson(TreeNode* node, const string& first, const string& last) const {
-        if (node == nullptr) return nullptr;  // Person not found
+    // Check if subtree is balanced and get its height
+    static void checkBalance(Node* node, bool& isBalanced, int& height) {
+        if (node == nullptr) {
+            isBalanced = true;
+            height = 0;
+            return;
+        }
         
-        // Compare last names first using custom comparison
-        int lastCompare = compareStrings(last, node->data.lastName);
+        bool leftBalanced, rightBalanced;
+        int leftHeight, rightHeight;
         
-        if (lastCompare < 0) {
-            return findPerson(node->left, first, last);
+        // Check balance of left and right subtrees
+        checkBalance(node->left, leftBalanced, leftHeight);
+        checkBalance(node->right, rightBalanced, rightHeight);
+        
+        // Current node is balanced if both subtrees are balanced and height difference <= 1
+        int diff = leftHeight - rightHeight;
+        if (diff < 0) diff = -diff;
+        
+        isBalanced = leftBalanced && rightBalanced && (diff <= 1);
+        
+        // Height is 1 + tallest subtree height
+        if (leftHeight > rightHeight) 
+            height = 1 + leftHeight;
+        else
+            height = 1 + rightHeight;
+    }
+    
+    // Build a perfectly balanced subtree from sorted nodes[first, last)
+    static Node* buildBalanced(const vector<Node*>& nodes, size_t first, size_t last) {
+        if (first >= last) return nullptr;
+        
+        size_t middle = first + (last - first) / 2;
+        Node* node = nodes[middle];
+        node->left = buildBalanced(nodes, first, middle);
+        node->right = buildBalanced(nodes, middle + 1, last);
+        updateNodeHeight(node);
+        return node;
+    }
+    
+    // Release every node of a subtree
+    void destroyAll(Node* node) {
+        if (node == nullptr) return;
+        
+        destroyAll(node->left);   // Release left subtree
+        destroyAll(node->right);  // Release right subtree
+        Traits::destroy(nodeAlloc, node);
+    }
+
+public:
+    // Constructor - initialize empty tree
+    OrderedIndex() : rootNode(nullptr), nodeCount(0) {}
+    
+    // An index owns its nodes, so it cannot be copied
+    OrderedIndex(const OrderedIndex&) = delete;
+    OrderedIndex& operator=(const OrderedIndex&) = delete;
+    
+    // Destructor - free all nodes (non-intrusive) or just forget them (intrusive)
+    ~OrderedIndex() {
+        clear();
+    }
+    
+    // Root node, for traversals done by the owner
+    Node* root() const {
+        return rootNode;
+    }
+    
+    // Number of linked nodes
+    size_t size() const {
+        return nodeCount;
+    }
+    
+    // Value stored in a node
+    static Value& value(Node* node) {
+        return Traits::value(node);
+    }
+    
+    // Find the node with a key (nullptr if none)
+    Node* find(const Key& key) const {
+        return findNode(rootNode, key);
+    }
+    
+    // Allocate an unlinked node holding a copy of a value (non-intrusive)
+    Node* createNode(const Value& v) {
+        return Traits::create(nodeAlloc, v);
+    }
+    
+    // Release a node that is not linked into the tree
+    void destroyNode(Node* node) {
+        Traits::destroy(nodeAlloc, node);
+    }
+    
+    // Copy a value into a new node (non-intrusive); returns nullptr if the key exists
+    Node* insert(const Value& v) {
+        Node* fresh = createNode(v);
+        if (link(fresh) == nullptr) {
+            destroyNode(fresh);
+            return nullptr;
         }
-        else if (lastCompare > 0) {
-            return findPerson(node->right, first, last);
+        return fresh;
+    }
+    
+    // Link nodes given in strictly increasing key order into an empty index as a
+    // balanced tree in linear time. Links nothing and returns false if the index is
+    // not empty or the nodes are out of order.
+    bool linkSorted(const vector<Node*>& nodes) {
+        if (rootNode != nullptr) return false;
+        for (size_t i = 1; i < nodes.size(); i++) {
+            if (compareTo(keyOf(Traits::value(nodes[i - 1])), nodes[i]) >= 0) return false;
         }
-        else {
-            // Last names match, compare first names using custom comparison
-            int firstCompare = compareStrings(first, node->data.firstName);
-            
-            if (firstCompare < 0) {
-                return findPerson(node->left, first, last);
-            }
-            else if (firstCompare > 0) {
-                return findPerson(node->right, first, last);
+        
+        rootNode = buildBalanced(nodes, 0, nodes.size());
+        nodeCount = nodes.size();
+        return true;
+    }
+    
+    // Link an unlinked node into the tree; returns nullptr if the key exists
+    Node* link(Node* node) {
+        node->left = nullptr;
+        node->right = nullptr;
+        node->height = 1;
+        
+        bool linked = false;
+        rootNode = insertNode(rootNode, node, linked);
+        if (!linked) return nullptr;
+        
+        nodeCount++;
+        return node;
+    }
+    
+    // Remove the node with a key; returns false if there is none
+    bool erase(const Key& key) {
+        Node* removed = nullptr;
+        rootNode = unlinkNode(rootNode, key, removed);
+        if (removed == nullptr) return false;
+        
+        nodeCount--;
+        Traits::destroy(nodeAlloc, removed);
+        return true;
+    }
+    
+    // Remove every node
+    void clear() {
+        destroyAll(rootNode);
+        rootNode = nullptr;
+        nodeCount = 0;
+    }
+    
+    // Check if the whole tree is balanced and get its height
+    void checkBalance(bool& isBalanced, int& height) const {
+        checkBalance(rootNode, isBalanced, height);
+    }
+};
+
+// Primary key of a person - last name, then first name
+struct NameKey {
+    const string& last;   // Last name
+    const string& first;  // First name
+    
+    NameKey(const string& l, const string& f) : last(l), first(f) {}
+};
+
+// Extracts the name key of a person
+struct PersonNameKey {
+    NameKey operator()(const Person& p) const {
+        return NameKey(p.lastName, p.firstName);
+    }
+};
+
+// Orders names by last name, then first name (case-sensitive)
+struct NameCompare {
+    int operator()(const NameKey& a, const NameKey& b) const {
+        int lastCompare = compareStrings(a.last, b.last);
+        if (lastCompare != 0) return lastCompare;
+        return compareStrings(a.first, b.first);
+    }
+};
+
+// Primary index of the database - persons ordered by name
+typedef OrderedIndex<NameKey, Person, PersonNameKey, NameCompare> PersonIndex;
+
+// Tree node structure for binary search tree
+typedef PersonIndex::Node TreeNode;
+
+// Split a data file line into space-separated fields; returns how many were found
+// (at most maxFields are stored, extra fields are counted but dropped)
+int splitRecord(const string& line, string fields[], int maxFields) {
+    int fieldIndex = 0;
+    string currentField = "";
+    
+    for (size_t i = 0; i <= line.length(); i++) {
+        if (i == line.length() || line[i] == ' ') {
+            if (!currentField.empty()) {
+                if (fieldIndex < maxFields) fields[fieldIndex] = currentField;
+                fieldIndex++;
+                currentField = "";
             }
-            else {
-                // Both first and last names match - found the person!
-                return node;
+        } else {
+            currentField += line[i];
+        }
+    }
+    return fieldIndex;
+}
+
+// Convert an SSN into an integer key. Dashes are ignored, so 123-45-6789 and 123456789
+// share a key; the digit count is folded in so 0000111 and 111 do not. Returns false
+// for anything else (such SSNs are kept in records but not indexed).
+bool parseSSN(const string& text, unsigned long long& value) {
+    unsigned long long digits = 0;
+    value = 0;
+    for (size_t i = 0; i < text.length(); i++) {
+        if (text[i] == '-') continue;
+        if (text[i] < '0' || text[i] > '9' || ++digits > 17) return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    if (digits == 0) return false;
+    
+    value = value * 32 + digits;
+    return true;
+}
+
+// Open-addressing hash table (linear probing) from SSN to the tree nodes holding it.
+// People sharing an SSN each get their own slot in the same probe run.
+class SSNIndex {
+private:
+    // Slots are 16 bytes, so four of them share a cache line
+    struct Slot {
+        unsigned long long ssn;  // SSN stored in this slot
+        TreeNode* node;          // Node with this SSN (nullptr marks an empty slot)
+    };
+    
+    vector<Slot> slots;  // Table size is always a power of two
+    size_t count;        // Number of occupied slots
+    int shift;           // 64 - log2(table size), used by the hash
+    
+    // Fibonacci hashing - multiply and keep the top bits
+    size_t homeSlot(unsigned long long ssn) const {
+        return (size_t)((ssn * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+    
+    // First slot holding the SSN, or the empty slot where it would go
+    size_t probe(unsigned long long ssn) const {
+        size_t mask = slots.size() - 1;
+        size_t i = homeSlot(ssn);
+        while (slots[i].node != nullptr && slots[i].ssn != ssn) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+    
+    // Empty slot at the end of the probe run for an SSN
+    size_t freeSlot(unsigned long long ssn) const {
+        size_t mask = slots.size() - 1;
+        size_t i = homeSlot(ssn);
+        while (slots[i].node != nullptr) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+    
+    // Double the table and re-insert every entry
+    void grow() {
+        vector<Slot> old;
+        old.swap(slots);
+        
+        Slot empty = { 0, nullptr };
+        slots.assign(old.size() * 2, empty);
+        shift--;
+        
+        for (size_t i = 0; i < old.size(); i++) {
+            if (old[i].node != nullptr) {
+                slots[freeSlot(old[i].ssn)] = old[i];
             }
         }
     }
+
+public:
+    // Constructor - start with a small empty table
+    SSNIndex() : count(0), shift(64 - 10) {
+        Slot empty = { 0, nullptr };
+        slots.assign(1 << 10, empty);
+    }
     
-    // Find the smallest node in a subtree (leftmost node)
-    TreeNode* findSmallestNode(TreeNode* node) {
-        if (node == nullptr) return nullptr;
-        
-        TreeNode* current = node;
-        while (current->left != nullptr) {
-            current = current->left;
+    // Find a node holding an SSN (nullptr if none)
+    TreeNode* find(unsigned long long ssn) const {
+        return slots[probe(ssn)].node;
+    }
+    
+    // Find every node holding an SSN
+    void findAll(unsigned long long ssn, vector<TreeNode*>& out) const {
+        size_t mask = slots.size() - 1;
+        out.clear();
+        for (size_t i = homeSlot(ssn); slots[i].node != nullptr; i = (i + 1) & mask) {
+            if (slots[i].ssn == ssn) out.push_back(slots[i].node);
         }
-        return current;
     }
     
-    // Delete a person from the tree using custom comparison
-    TreeNode* deletePerson(TreeNode* node, const string& first, const string& last) {
-        if (node == nullptr) return nullptr;
+    // Add a holder of an SSN; returns a node that already held it (nullptr if none)
+    TreeNode* insert(unsigned long long ssn, TreeNode* node) {
+        // Keep the load factor under 70% so probe sequences stay short
+        if ((count + 1) * 10 > slots.size() * 7) grow();
+        
+        TreeNode* holder = find(ssn);
+        size_t i = freeSlot(ssn);
+        slots[i].ssn = ssn;
+        slots[i].node = node;
+        count++;
+        return holder;
+    }
+    
+    // Remove the entry of a node under an SSN (other holders stay indexed)
+    void erase(unsigned long long ssn, TreeNode* node) {
+        if (node == nullptr) return;
         
-        // Compare last names first using custom comparison
-        int lastCompare = compareStrings(last, node->data.lastName);
+        size_t mask = slots.size() - 1;
+        size_t hole = homeSlot(ssn);
+        while (slots[hole].node != nullptr && (slots[hole].ssn != ssn || slots[hole].node != node)) {
+            hole = (hole + 1) & mask;
+        }
+        if (slots[hole].node == nullptr) return;
         
-        // Search for the node to delete
-        if (lastCompare < 0) {
-            node->left = deletePerson(node->left, first, last);
+        // Shift later entries of the probe run back so no tombstones are needed
+        size_t i = hole;
+        while (true) {
+            i = (i + 1) & mask;
+            if (slots[i].node == nullptr) break;
+            
+            size_t home = homeSlot(slots[i].ssn);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                slots[hole] = slots[i];
+                hole = i;
+            }
         }
-        else if (lastCompare > 0) {
-            node->right = deletePerson(node->right, first, last);
+        slots[hole].node = nullptr;
+        count--;
+    }
+};
+
+// Set-associative cache from a name to its tree node, checked before the AVL descent.
+// A set is one 64-byte cache line holding four 16-byte entries. Within a set a CLOCK
+// hand picks the victim, so names hit since the hand last passed get a second chance.
+class LookupCache {
+private:
+    struct Entry {
+        unsigned int tag;         // Low bits of the name hash
+        unsigned int referenced;  // CLOCK bit - set on every hit
+        TreeNode* node;           // Cached node (nullptr marks an empty entry)
+    };
+    
+    struct Set {
+        Entry ways[4];
+    };
+    
+    vector<char> storage;         // Memory for the sets, with room to align them
+    Set* sets;                    // Sets aligned to a cache line
+    vector<unsigned char> hands;  // CLOCK hand of each set
+    int shift;                    // 64 - log2(number of sets), used to pick a set
+    size_t used;                  // Entries holding a node
+    unsigned long long hits;      // Lookups answered by the cache
+    unsigned long long misses;    // Lookups that had to search the tree
+    
+    // FNV-1a over last name, a separator and first name
+    static unsigned long long hashName(const string& first, const string& last) {
+        unsigned long long h = 14695981039346656037ULL;
+        for (size_t i = 0; i < last.length(); i++) {
+            h = (h ^ (unsigned char)last[i]) * 1099511628211ULL;
         }
-        else {
-            // Last names match, compare first names using custom comparison
-            int firstCompare = compareStrings(first, node->data.firstName);
+        h = (h ^ 0xFF) * 1099511628211ULL;
+        for (size_t i = 0; i < first.length(); i++) {
+            h = (h ^ (unsigned char)first[i]) * 1099511628211ULL;
+        }
+        return h;
+    }
+    
+    // Set for a hash (Fibonacci hashing, as in SSNIndex)
+    Set& setFor(unsigned long long h) const {
+        return sets[(size_t)((h * 0x9E3779B97F4A7C15ULL) >> shift)];
+    }
+
+public:
+    // Constructor - 4096 sets of 4 entries (256 KiB)
+    LookupCache() : shift(64 - 12), used(0), hits(0), misses(0) {
+        size_t setCount = (size_t)1 << (64 - shift);
+        storage.assign(setCount * sizeof(Set) + 64, 0);
+        size_t address = (size_t)storage.data();
+        sets = (Set*)(storage.data() + ((64 - address % 64) % 64));
+        hands.assign(setCount, 0);
+    }
+    
+    // Cached node for a name (nullptr on a miss)
+    TreeNode* find(const string& first, const string& last) {
+        unsigned long long h = hashName(first, last);
+        Set& set = setFor(h);
+        for (int way = 0; way < 4; way++) {
+            Entry& entry = set.ways[way];
+            if (entry.node != nullptr && entry.tag == (unsigned int)h &&
+                entry.node->data.lastName == last && entry.node->data.firstName == first) {
+                entry.referenced = 1;
+                hits++;
+                return entry.node;
+            }
+        }
+        misses++;
+        return nullptr;
+    }
+    
+    // Cache a node found in the tree, evicting with the set's CLOCK hand
+    void store(TreeNode* node) {
+        unsigned long long h = hashName(node->data.firstName, node->data.lastName);
+        Set& set = setFor(h);
+        unsigned char& hand = hands[&set - sets];
+        while (set.ways[hand].node != nullptr && set.ways[hand].referenced != 0) {
+            set.ways[hand].referenced = 0;
+            hand = (hand + 1) & 3;
+        }
+        
+        Entry& victim = set.ways[hand];
+        if (victim.node == nullptr) used++;
+        victim.tag = (unsigned int)h;
+        victim.referenced = 0;
+        victim.node = node;
+        hand = (hand + 1) & 3;
+    }
+    
+    // Drop a node that is about to be deleted
+    void forget(TreeNode* node) {
+        Set& set = setFor(hashName(node->data.firstName, node->data.lastName));
+        for (int way = 0; way < 4; way++) {
+            if (set.ways[way].node == node) {
+                set.ways[way].node = nullptr;
+                used--;
+            }
+        }
+    }
+    
+    // Drop every entry (the counters keep running)
+    void clear() {
+        memset(sets, 0, hands.size() * sizeof(Set));
+        fill(hands.begin(), hands.end(), 0);
+        used = 0;
+    }
+    
+    // Usage counters for CACHESTATS
+    unsigned long long hitCount() const { return hits; }
+    unsigned long long missCount() const { return misses; }
+    size_t entriesUsed() const { return used; }
+    size_t capacity() const { return hands.size() * 4; }
+};
+
+// Lower-case an ASCII character (names are compared case-insensitively when fuzzy)
+inline unsigned char foldChar(char c) {
+    if (c >= 'A' && c <= 'Z') return (unsigned char)(c - 'A' + 'a');
+    return (unsigned char)c;
+}
+
+// Edit distance from a fixed name to candidate names. Names of up to 64 characters
+// use Myers' bit-parallel algorithm, which updates a whole DP column per character
+// with a handful of 64-bit word operations.
+class NameMatcher {
+private:
+    string pattern;                // Lower-cased "first last" being searched for
+    unsigned long long peq[256];   // Bit i set where pattern[i] is that character
+    
+    // Myers' algorithm (Hyyro's formulation for global edit distance)
+    int bitParallelDistance(const string& first, const string& last, int limit) const {
+        int m = (int)pattern.length();
+        unsigned long long highBit = 1ULL << (m - 1);
+        unsigned long long pv = ~0ULL;
+        unsigned long long mv = 0;
+        int score = m;
+        
+        size_t textLength = first.length() + 1 + last.length();
+        for (size_t j = 0; j < textLength; j++) {
+            char c = ' ';
+            if (j < first.length()) c = first[j];
+            else if (j > first.length()) c = last[j - first.length() - 1];
+            
+            unsigned long long eq = peq[foldChar(c)];
+            unsigned long long xv = eq | mv;
+            unsigned long long xh = (((eq & pv) + pv) ^ pv) | eq;
+            unsigned long long ph = mv | ~(xh | pv);
+            unsigned long long mh = pv & xh;
+            
+            if (ph & highBit) score++;
+            else if (mh & highBit) score--;
             
-            if (firstCompare < 0) {
-                node->left = deletePerson(node->left, first, last);
+            // Stop once even matching every remaining character cannot get under the limit
+            if (score - (int)(textLength - j - 1) > limit) return limit + 1;
+            
+            ph = (ph << 1) | 1;
+            mh = mh << 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+        }
+        return score;
+    }
+    
+    // Classic dynamic programming for names too long for one machine word
+    int dynamicDistance(const string& first, const string& last) const {
+        string text = first + " " + last;
+        vector<int> row(pattern.length() + 1);
+        for (size_t i = 0; i <= pattern.length(); i++) row[i] = (int)i;
+        
+        for (size_t j = 1; j <= text.length(); j++) {
+            int diagonal = row[0];
+            row[0] = (int)j;
+            for (size_t i = 1; i <= pattern.length(); i++) {
+                int above = row[i];
+                int cost = (pattern[i - 1] == (char)foldChar(text[j - 1])) ? 0 : 1;
+                int best = diagonal + cost;
+                if (row[i] + 1 < best) best = row[i] + 1;
+                if (row[i - 1] + 1 < best) best = row[i - 1] + 1;
+                row[i] = best;
+                diagonal = above;
             }
-            else if (firstCompare > 0) {
-                node->right = deletePerson(node->right, first, last);
+        }
+        return row[pattern.length()];
+    }
+
+public:
+    // Constructor - prepare the match masks for a name
+    NameMatcher(const string& first, const string& last) {
+        pattern = foldName(first, last);
+        for (int c = 0; c < 256; c++) peq[c] = 0;
+        for (size_t i = 0; i < pattern.length() && i < 64; i++) {
+            peq[(unsigned char)pattern[i]] |= 1ULL << i;
+        }
+    }
+    
+    // Lower-cased "first last"
+    static string foldName(const string& first, const string& last) {
+        string name = first + " " + last;
+        for (size_t i = 0; i < name.length(); i++) name[i] = (char)foldChar(name[i]);
+        return name;
+    }
+    
+    // Lower-cased name being searched for
+    const string& name() const {
+        return pattern;
+    }
+    
+    // Edit distance to a person's name (any value above limit means "too far")
+    int distance(const Person& p, int limit) const {
+        if (pattern.length() <= 64) return bitParallelDistance(p.firstName, p.lastName, limit);
+        return dynamicDistance(p.firstName, p.lastName);
+    }
+};
+
+// Trigram index over lower-cased "first last" names, used to prune fuzzy searches
+class NameTrigramIndex {
+private:
+    unordered_map<unsigned int, vector<TreeNode*> > postings;  // Trigram -> nodes containing it
+    unordered_set<TreeNode*> removed;  // Deleted nodes not yet purged from the postings
+    size_t liveCount;                  // Number of indexed names
+    vector<unsigned int> scratch;      // Trigram buffer reused by add()
+    
+    // Distinct trigrams of a folded name, padded with '$' at both ends
+    static void nameTrigrams(const string& name, vector<unsigned int>& grams) {
+        string text = "$" + name + "$";
+        grams.clear();
+        for (size_t i = 0; i + 2 < text.length(); i++) {
+            grams.push_back(((unsigned int)(unsigned char)text[i] << 16) |
+                            ((unsigned int)(unsigned char)text[i + 1] << 8) |
+                            (unsigned int)(unsigned char)text[i + 2]);
+        }
+        sort(grams.begin(), grams.end());
+        grams.erase(unique(grams.begin(), grams.end()), grams.end());
+    }
+    
+    // Drop deleted nodes from every posting list
+    void purgeRemoved() {
+        unordered_map<unsigned int, vector<TreeNode*> >::iterator it;
+        for (it = postings.begin(); it != postings.end(); ++it) {
+            vector<TreeNode*>& list = it->second;
+            size_t kept = 0;
+            for (size_t i = 0; i < list.size(); i++) {
+                if (removed.count(list[i]) == 0) list[kept++] = list[i];
             }
-            else {
-                // Found the node to delete
-                
-                // Case 1: Node has no children or one child
-                if (node->left == nullptr || node->right == nullptr) {
-                    TreeNode* temp = node->left;
-                    if (temp == nullptr) temp = node->right;
-                    
-                    // No children case
-                    if (temp == nullptr) {
-                        delete node;
-                        return nullptr;
-                    } 
-                    // One child case - replace with child
-                    else {
-                        // Copy the contents
-                        node->data = temp->data;
-                        node->left = temp->left;
-                        node->right = temp->right;
-                        node->height = temp->height;
-                        delete temp;
-                    }
-                }
-                // Case 2: Node has two children
-                else {
-                    // Find smallest node in right subtree
-                    TreeNode* temp = findSmallestNode(node->right);
-                    
-                    // Copy data from smallest node
-                    node->data = temp->data;
-                    
-                    // Delete the smallest node from right subtree
-                    node->right = deletePerson(node->right, temp->data.firstName, temp->data.lastName);
-                }
+            list.resize(kept);
+        }
+        removed.clear();
+    }
+
+public:
+    // Constructor - start with an empty index
+    NameTrigramIndex() : liveCount(0) {}
+    
+    // Index the name of a newly inserted person
+    void add(TreeNode* node) {
+        // A new node may reuse the address of a deleted one
+        removed.erase(node);
+        
+        nameTrigrams(NameMatcher::foldName(node->data.firstName, node->data.lastName), scratch);
+        for (size_t i = 0; i < scratch.size(); i++) {
+            postings[scratch[i]].push_back(node);
+        }
+        liveCount++;
+    }
+    
+    // Forget a person that is about to be deleted. Posting lists are cleaned up in
+    // batches, since a single list can hold a large share of all names.
+    void remove(TreeNode* node) {
+        removed.insert(node);
+        liveCount--;
+        if (removed.size() > 1024 && removed.size() * 8 > liveCount) purgeRemoved();
+    }
+    
+    // Collect nodes that may be within maxDistance of a name. Returns false when the
+    // name is too short for trigrams to rule anything out, so every name is a candidate.
+    bool candidates(const string& name, int maxDistance, vector<TreeNode*>& out) const {
+        out.clear();
+        
+        // Each edit destroys at most three of the query's trigrams
+        vector<unsigned int> grams;
+        nameTrigrams(name, grams);
+        int needed = (int)grams.size() - 3 * maxDistance;
+        if (needed <= 0) return false;
+        
+        // A match shares at least 'needed' trigrams, so it must appear in at least one
+        // of any (grams - needed + 1) lists - use the shortest ones
+        vector<pair<size_t, const vector<TreeNode*>*> > lists;
+        for (size_t i = 0; i < grams.size(); i++) {
+            unordered_map<unsigned int, vector<TreeNode*> >::const_iterator it = postings.find(grams[i]);
+            if (it == postings.end()) lists.push_back(make_pair((size_t)0, (const vector<TreeNode*>*)nullptr));
+            else lists.push_back(make_pair(it->second.size(), &it->second));
+        }
+        sort(lists.begin(), lists.end());
+        
+        size_t useLists = grams.size() - needed + 1;
+        for (size_t i = 0; i < useLists; i++) {
+            if (lists[i].second == nullptr) continue;
+            const vector<TreeNode*>& list = *lists[i].second;
+            for (size_t j = 0; j < list.size(); j++) {
+                if (removed.count(list[j]) == 0) out.push_back(list[j]);
             }
         }
         
-        // Balance the tree after deletion
-        return balanceNode(node);
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+        return true;
+    }
+};
+
+// Columns of the columnar mirror and operators of SELECT filters
+enum QueryColumn { COL_STATE, COL_ZIP, COL_BIRTHDATE, COL_BIRTHYEAR, COL_BALANCE };
+enum QueryOperator { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE };
+
+// Two-letter state as a 16-bit code (first letter in the high byte)
+inline unsigned short stateCode(const string& state) {
+    unsigned short code = 0;
+    if (state.length() > 0) code = (unsigned short)((unsigned char)state[0] << 8);
+    if (state.length() > 1) code |= (unsigned char)state[1];
+    return code;
+}
+
+// Index of the lowest set bit of a non-zero word
+inline int lowestBit(unsigned long long word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while ((word & 1) == 0) { word >>= 1; bit++; }
+    return bit;
+#endif
+}
+
+// Number of set bits in a word
+inline int countBits(unsigned long long word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int bits = 0;
+    while (word != 0) { word &= word - 1; bits++; }
+    return bits;
+#endif
+}
+
+// Scalar form of a filter comparison (Op is a compile-time constant, so this folds)
+template <int Op, class T>
+inline bool passesFilter(T value, T constant) {
+    if (Op == OP_EQ) return value == constant;
+    if (Op == OP_NE) return value != constant;
+    if (Op == OP_LT) return value < constant;
+    if (Op == OP_LE) return value <= constant;
+    if (Op == OP_GT) return value > constant;
+    return value >= constant;
+}
+
+// Filter kernels: clear the bitmap bit of every row whose value fails "value Op constant".
+// Blocks of 64 rows are compared with SSE2 and turned into one bitmap word with movemask.
+template <int Op>
+void filterIntColumn(const int* column, size_t rows, int constant, unsigned long long* bitmap) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // NE, LE and GE are computed as the complement of EQ, GT and LT
+    bool invert = (Op == OP_NE || Op == OP_LE || Op == OP_GE);
+    __m128i c = _mm_set1_epi32(constant);
+    for (; i + 64 <= rows; i += 64) {
+        unsigned long long bits = 0;
+        for (int k = 0; k < 64; k += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(column + i + k));
+            __m128i m;
+            if (Op == OP_EQ || Op == OP_NE) m = _mm_cmpeq_epi32(x, c);
+            else if (Op == OP_LT || Op == OP_GE) m = _mm_cmplt_epi32(x, c);
+            else m = _mm_cmpgt_epi32(x, c);
+            bits |= (unsigned long long)_mm_movemask_ps(_mm_castsi128_ps(m)) << k;
+        }
+        if (invert) bits = ~bits;
+        bitmap[i / 64] &= bits;
+    }
+#endif
+    for (; i < rows; i++) {
+        if (!passesFilter<Op>(column[i], constant)) bitmap[i / 64] &= ~(1ULL << (i % 64));
+    }
+}
+
+template <int Op>
+void filterDoubleColumn(const double* column, size_t rows, double constant, unsigned long long* bitmap) {
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128d c = _mm_set1_pd(constant);
+    for (; i + 64 <= rows; i += 64) {
+        unsigned long long bits = 0;
+        for (int k = 0; k < 64; k += 2) {
+            __m128d x = _mm_loadu_pd(column + i + k);
+            __m128d m;
+            if (Op == OP_EQ) m = _mm_cmpeq_pd(x, c);
+            else if (Op == OP_NE) m = _mm_cmpneq_pd(x, c);
+            else if (Op == OP_LT) m = _mm_cmplt_pd(x, c);
+            else if (Op == OP_LE) m = _mm_cmple_pd(x, c);
+            else if (Op == OP_GT) m = _mm_cmpgt_pd(x, c);
+            else m = _mm_cmpge_pd(x, c);
+            bits |= (unsigned long long)_mm_movemask_pd(m) << k;
+        }
+        bitmap[i / 64] &= bits;
+    }
+#endif
+    for (; i < rows; i++) {
+        if (!passesFilter<Op>(column[i], constant)) bitmap[i / 64] &= ~(1ULL << (i % 64));
+    }
+}
+
+template <int Op>
+void filterStateColumn(const unsigned short* column, size_t rows, unsigned short constant,
+                       unsigned long long* bitmap) {
+    size_t i = 0;
+#ifdef __SSE2__
+    if (Op == OP_EQ || Op == OP_NE) {
+        __m128i c = _mm_set1_epi16((short)constant);
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 64 <= rows; i += 64) {
+            unsigned long long bits = 0;
+            for (int k = 0; k < 64; k += 8) {
+                __m128i x = _mm_loadu_si128((const __m128i*)(column + i + k));
+                __m128i m = _mm_packs_epi16(_mm_cmpeq_epi16(x, c), zero);
+                bits |= (unsigned long long)(_mm_movemask_epi8(m) & 0xFF) << k;
+            }
+            if (Op == OP_NE) bits = ~bits;
+            bitmap[i / 64] &= bits;
+        }
+    }
+#endif
+    for (; i < rows; i++) {
+        if (!passesFilter<Op>(column[i], constant)) bitmap[i / 64] &= ~(1ULL << (i % 64));
+    }
+}
+
+// Sum, minimum and maximum of a column over the rows selected by a bitmap
+struct ColumnTotals {
+    long long count;    // Values aggregated
+    double sum;
+    double min;
+    double max;
+};
+
+#ifdef __SSE2__
+// Two column values as doubles
+inline __m128d loadPair(const double* values) {
+    return _mm_loadu_pd(values);
+}
+
+inline __m128d loadPair(const int* values) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)values));
+}
+#endif
+
+// Aggregate kernel: blocks of 64 rows are summed two lanes at a time, with each pair
+// of bitmap bits turned into a lane mask so unselected rows add nothing.
+template <class T>
+void totalColumn(const T* column, size_t rows, const unsigned long long* bitmap, ColumnTotals& totals) {
+    totals.count = 0;
+    totals.sum = 0;
+    totals.min = HUGE_VAL;
+    totals.max = -HUGE_VAL;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128d lanes[4] = {
+        _mm_castsi128_pd(_mm_set_epi32(0, 0, 0, 0)),
+        _mm_castsi128_pd(_mm_set_epi32(0, 0, -1, -1)),
+        _mm_castsi128_pd(_mm_set_epi32(-1, -1, 0, 0)),
+        _mm_castsi128_pd(_mm_set_epi32(-1, -1, -1, -1))
+    };
+    __m128d above = _mm_set1_pd(HUGE_VAL);
+    __m128d below = _mm_set1_pd(-HUGE_VAL);
+    __m128d sum = _mm_setzero_pd();
+    __m128d low = above;
+    __m128d high = below;
+    for (; i + 64 <= rows; i += 64) {
+        unsigned long long bits = bitmap[i / 64];
+        if (bits == 0) continue;
+        totals.count += countBits(bits);
+        for (int k = 0; k < 64; k += 2) {
+            __m128d keep = lanes[(bits >> k) & 3];
+            __m128d x = _mm_and_pd(loadPair(column + i + k), keep);
+            sum = _mm_add_pd(sum, x);
+            low = _mm_min_pd(low, _mm_or_pd(x, _mm_andnot_pd(keep, above)));
+            high = _mm_max_pd(high, _mm_or_pd(x, _mm_andnot_pd(keep, below)));
+        }
+    }
+    double lane[2];
+    _mm_storeu_pd(lane, sum);
+    totals.sum = lane[0] + lane[1];
+    _mm_storeu_pd(lane, low);
+    totals.min = min(lane[0], lane[1]);
+    _mm_storeu_pd(lane, high);
+    totals.max = max(lane[0], lane[1]);
+#endif
+    for (; i < rows; i++) {
+        if ((bitmap[i / 64] >> (i % 64) & 1) == 0) continue;
+        double value = column[i];
+        totals.count++;
+        totals.sum += value;
+        totals.min = min(totals.min, value);
+        totals.max = max(totals.max, value);
+    }
+}
+
+// Call visit(row) for every row selected by a bitmap. Fully selected 64-row blocks
+// are walked directly instead of bit by bit.
+template <class Visit>
+inline void forEachSelected(const unsigned long long* bitmap, size_t rows, Visit visit) {
+    for (size_t base = 0; base < rows; base += 64) {
+        unsigned long long bits = bitmap[base / 64];
+        if (bits == ~0ULL) {
+            for (size_t row = base; row < base + 64; row++) visit(row);
+        } else {
+            for (; bits != 0; bits &= bits - 1) visit(base + lowestBit(bits));
+        }
+    }
+}
+
+// Grouped aggregate kernel: one pass over the selected rows adding each value to the
+// totals of its row's group. Scattering into per-group totals does not map onto SSE2
+// lanes, so this pass is scalar; the group totals are small enough to stay in L1.
+template <class T>
+void totalColumnByGroup(const T* column, const unsigned short* groups, size_t rows,
+                        const unsigned long long* bitmap, ColumnTotals* totals) {
+    forEachSelected(bitmap, rows, [&](size_t row) {
+        ColumnTotals& t = totals[groups[row]];
+        double value = column[row];
+        t.count++;
+        t.sum += value;
+        if (value < t.min) t.min = value;
+        if (value > t.max) t.max = value;
+    });
+}
+
+// Columnar mirror of the fields analytical queries scan. Row ids are dense, so every
+// column is a contiguous array; deleting a row moves the last row into its place.
+class ColumnStore {
+private:
+    vector<unsigned short> states;     // State code of each row
+    vector<int> zipCodes;              // Zip code as a number (0 if not numeric)
+    vector<unsigned long long> zipKnown;  // Bitmap of the rows whose zip code is numeric
+    vector<int> birthDates;            // Birth date as yyyymmdd
+    vector<int> birthYears;            // Birth year
+    vector<double> balances;           // Account balance
+    vector<TreeNode*> rowNodes;        // Person each row belongs to
+    unordered_map<TreeNode*, size_t> rowOf;  // Row id of each person
+    vector<unsigned short> groups;     // State group of each row (dense ids for GROUP BY)
+    vector<unsigned short> groupStates;  // State code of each group
+    unordered_map<unsigned short, unsigned short> groupOf;  // Group of each state code
+    
+    // Zip code as a number for range filters; false if it is not one
+    static bool zipNumber(const string& zip, int& value) {
+        value = 0;
+        if (zip.empty() || zip.length() > 9) return false;
+        for (size_t i = 0; i < zip.length(); i++) {
+            if (zip[i] < '0' || zip[i] > '9') {
+                value = 0;
+                return false;
+            }
+            value = value * 10 + (zip[i] - '0');
+        }
+        return true;
+    }
+    
+    // Store the zip code of a row along with whether it is numeric
+    void setZip(size_t row, const string& zip) {
+        unsigned long long bit = 1ULL << (row % 64);
+        if (zipNumber(zip, zipCodes[row])) zipKnown[row / 64] |= bit;
+        else zipKnown[row / 64] &= ~bit;
+    }
+    
+    // Drop the rows without a numeric zip code from a bitmap, so they fail every ZIP
+    // condition and stay out of ZIP aggregates
+    void keepKnownZips(unsigned long long* bitmap) const {
+        for (size_t w = 0; w < zipKnown.size(); w++) bitmap[w] &= zipKnown[w];
+    }
+
+public:
+    // Number of rows
+    size_t size() const {
+        return rowNodes.size();
+    }
+    
+    // Append a row for a person (all fields must be parsed)
+    void addRow(TreeNode* node) {
+        const Person& p = node->data;
+        rowOf[node] = rowNodes.size();
+        states.push_back(stateCode(p.state));
+        
+        // Groups are never retired; one whose state has no rows left is just empty
+        unordered_map<unsigned short, unsigned short>::iterator group = groupOf.find(states.back());
+        if (group == groupOf.end()) {
+            group = groupOf.insert(make_pair(states.back(), (unsigned short)groupStates.size())).first;
+            groupStates.push_back(states.back());
+        }
+        groups.push_back(group->second);
+        zipCodes.push_back(0);
+        if (rowNodes.size() % 64 == 0) zipKnown.push_back(0);
+        setZip(rowNodes.size(), p.zipCode);
+        birthDates.push_back(p.birthYear * 10000 + p.birthMonth * 100 + p.birthDay);
+        birthYears.push_back(p.birthYear);
+        balances.push_back(p.balance);
+        rowNodes.push_back(node);
+    }
+    
+    // Remove the row of a person by moving the last row into its place
+    void removeRow(TreeNode* node) {
+        unordered_map<TreeNode*, size_t>::iterator it = rowOf.find(node);
+        if (it == rowOf.end()) return;
+        
+        size_t row = it->second;
+        size_t last = rowNodes.size() - 1;
+        rowOf.erase(it);
+        if (row != last) {
+            states[row] = states[last];
+            groups[row] = groups[last];
+            zipCodes[row] = zipCodes[last];
+            unsigned long long bit = 1ULL << (row % 64);
+            if (zipKnown[last / 64] >> (last % 64) & 1) zipKnown[row / 64] |= bit;
+            else zipKnown[row / 64] &= ~bit;
+            birthDates[row] = birthDates[last];
+            birthYears[row] = birthYears[last];
+            balances[row] = balances[last];
+            rowNodes[row] = rowNodes[last];
+            rowOf[rowNodes[row]] = row;
+        }
+        states.pop_back();
+        groups.pop_back();
+        zipCodes.pop_back();
+        if (last % 64 == 0) zipKnown.pop_back();
+        else zipKnown.back() &= ~(1ULL << (last % 64));
+        birthDates.pop_back();
+        birthYears.pop_back();
+        balances.pop_back();
+        rowNodes.pop_back();
+    }
+    
+    // Refresh the zip code of a person after RELOCATE
+    void updateZip(TreeNode* node) {
+        unordered_map<TreeNode*, size_t>::iterator it = rowOf.find(node);
+        if (it != rowOf.end()) setZip(it->second, node->data.zipCode);
+    }
+    
+    // Person stored in a row
+    TreeNode* node(size_t row) const {
+        return rowNodes[row];
+    }
+    
+    // Whether a row has a value in a column (only zip codes can be missing)
+    bool known(int column, size_t row) const {
+        return column != COL_ZIP || (zipKnown[row / 64] >> (row % 64) & 1) != 0;
+    }
+    
+    // Column values as a number (used for ordering)
+    double value(int column, size_t row) const {
+        if (column == COL_STATE) return states[row];
+        if (column == COL_ZIP) return zipCodes[row];
+        if (column == COL_BIRTHDATE) return birthDates[row];
+        if (column == COL_BIRTHYEAR) return birthYears[row];
+        return balances[row];
+    }
+    
+    // Number of state groups, and the state code of one
+    size_t groupCount() const {
+        return groupStates.size();
+    }
+    
+    unsigned short groupState(size_t group) const {
+        return groupStates[group];
+    }
+    
+    // Number of rows of each state group in a bitmap
+    void countByGroup(const unsigned long long* bitmap, vector<long long>& counts) const {
+        counts.assign(groupStates.size(), 0);
+        const unsigned short* rowGroups = groups.data();
+        forEachSelected(bitmap, rowNodes.size(), [&](size_t row) {
+            counts[rowGroups[row]]++;
+        });
+    }
+    
+    // Keep only the rows of the bitmap that pass "column op constant"
+    template <int Op>
+    void filter(int column, double constant, unsigned long long* bitmap) const {
+        size_t rows = rowNodes.size();
+        if (column == COL_STATE) {
+            filterStateColumn<Op>(states.data(), rows, (unsigned short)constant, bitmap);
+        } else if (column == COL_BALANCE) {
+            filterDoubleColumn<Op>(balances.data(), rows, constant, bitmap);
+        } else {
+            const int* values = birthYears.data();
+            if (column == COL_ZIP) {
+                keepKnownZips(bitmap);
+                values = zipCodes.data();
+            }
+            if (column == COL_BIRTHDATE) values = birthDates.data();
+            filterIntColumn<Op>(values, rows, (int)constant, bitmap);
+        }
+    }
+    
+    // Sum, minimum and maximum of a column over the rows in a bitmap
+    void totals(int column, const unsigned long long* bitmap, ColumnTotals& out) const {
+        size_t rows = rowNodes.size();
+        if (column == COL_ZIP) {
+            vector<unsigned long long> known(bitmap, bitmap + zipKnown.size());
+            keepKnownZips(known.data());
+            totalColumn(zipCodes.data(), rows, known.data(), out);
+        } else if (column == COL_BALANCE) {
+            totalColumn(balances.data(), rows, bitmap, out);
+        } else if (column == COL_BIRTHDATE) {
+            totalColumn(birthDates.data(), rows, bitmap, out);
+        } else {
+            totalColumn(birthYears.data(), rows, bitmap, out);
+        }
+    }
+    
+    // The same per state group (out gets one entry per group)
+    void totalsByGroup(int column, const unsigned long long* bitmap, vector<ColumnTotals>& out) const {
+        ColumnTotals empty = { 0, 0, HUGE_VAL, -HUGE_VAL };
+        out.assign(groupStates.size(), empty);
+        size_t rows = rowNodes.size();
+        const unsigned short* rowGroups = groups.data();
+        if (column == COL_BALANCE) {
+            totalColumnByGroup(balances.data(), rowGroups, rows, bitmap, out.data());
+        } else if (column == COL_ZIP) {
+            vector<unsigned long long> known(bitmap, bitmap + zipKnown.size());
+            keepKnownZips(known.data());
+            totalColumnByGroup(zipCodes.data(), rowGroups, rows, known.data(), out.data());
+        } else if (column == COL_BIRTHDATE) {
+            totalColumnByGroup(birthDates.data(), rowGroups, rows, bitmap, out.data());
+        } else {
+            totalColumnByGroup(birthYears.data(), rowGroups, rows, bitmap, out.data());
+        }
     }
+};
+
+// Aggregates of SELECT items (ITEM_STATE is the plain STATE column)
+enum QueryFunction { ITEM_STATE, AGG_COUNT, AGG_SUM, AGG_AVG, AGG_MIN, AGG_MAX };
+
+// One SELECT item, e.g. AVG(BALANCE)
+struct QueryItem {
+    int function;   // QueryFunction
+    int column;     // QueryColumn aggregated (unused for COUNT and STATE)
+    string label;   // Text shown in the result header
+};
+
+// One WHERE condition - column op constant
+struct QueryFilter {
+    int column;      // QueryColumn
+    int op;          // QueryOperator
+    double value;    // Constant (state code for STATE)
+};
+
+// Parsed form of SELECT ... WHERE ... GROUP BY STATE ORDER BY ... LIMIT n
+struct Query {
+    bool allColumns;             // SELECT * - list whole records
+    vector<QueryItem> items;     // Aggregates and STATE otherwise
+    vector<QueryFilter> filters; // Conditions joined by AND
+    bool groupByState;           // GROUP BY STATE
+    int orderColumn;             // SELECT *: column to sort by (-1 = name order)
+    int orderItem;               // Aggregates: item to sort by (-1 = state order)
+    bool descending;             // ORDER BY ... DESC
+    long long limit;             // LIMIT n (-1 = no limit)
+    
+    Query() : allColumns(false), groupByState(false), orderColumn(-1), orderItem(-1),
+              descending(false), limit(-1) {}
+};
+
+// States of a background save
+enum SaveState { SAVE_IDLE, SAVE_RUNNING, SAVE_DONE, SAVE_FAILED };
+
+// Progress of a save, shared between the command loop and the writer process
+struct SaveProgress {
+    atomic<long long> recordsWritten;  // Records written so far
+    atomic<long long> recordsTotal;    // Records in the snapshot
+    atomic<int> state;                 // Current SaveState
+    
+    SaveProgress() : recordsWritten(0), recordsTotal(0), state(SAVE_IDLE) {}
+};
+
+// Header of the sidecar index (<data file>.idx) used by lazy loading. It is followed
+// by one entry per person in name order: the byte offset of the record in the data
+// file (8 bytes), the lengths of last name, first name and SSN (2 bytes each) and
+// then those three strings. Numbers are in host byte order; a sidecar whose data
+// file size, inode or modification time (in nanoseconds) does not match is ignored
+// and rebuilt.
+struct SidecarHeader {
+    char magic[8];          // "PDBIDX02"
+    long long dataSize;     // Size of the data file it indexes
+    long long dataTime;     // Modification time of that data file (ns since the epoch)
+    long long dataInode;    // Inode of that data file
+    long long recordCount;  // Number of entries that follow
+};
+
+// Main database class that manages all operations
+class PersonDatabase {
+private:
+    PersonIndex people;  // Primary index - AVL tree of persons ordered by name
+    SSNIndex ssnIndex;   // Hash index from SSN to tree node
+    mutable LookupCache lookupCache;  // Recently found names, checked before the tree
+    NameTrigramIndex trigramIndex;  // Trigram index over names for FUZZY
+    bool trigramIndexReady;         // Trigram index covers every person (built on demand when lazy)
+    ColumnStore columns;            // Columnar mirror for SELECT
+    bool columnsReady;              // Mirror covers every person (built by the first SELECT)
     
-    // Display all person information
-    void displayPersonInfo(const Person& p) const {
+    bool lazyMode;           // Records are parsed from the mapped data file on first use
+    const char* mappedData;  // Data file mapped into memory (lazy mode)
+    mutable long long unreadableRecords;  // Lazily loaded records that failed to parse
+    size_t mappedSize;       // Size of the mapping
+    
+    SaveProgress* saveProgress;  // Progress of the last background save (shared memory)
+    string saveTarget;           // File the last background save was written to
+#ifdef PERSONDB_POSIX
+    pid_t saveChild;             // Writer process of a running background save (0 if none)
+#endif
+    
+    // Find a specific person, through the lookup cache for names asked for recently
+    TreeNode* findPerson(const string& first, const string& last) const {
+        TreeNode* node = lookupCache.find(first, last);
+        if (node != nullptr) return node;
+        
+        node = people.find(NameKey(last, first));
+        if (node != nullptr) lookupCache.store(node);
+        return node;
+    }
+    
+    // SSN of a stored person as an index key (false if it cannot be indexed)
+    bool ssnKey(const Person& p, unsigned long long& key) const {
+        return parseSSN(p.ssn, key);
+    }
+    
+    // Line of the mapped data file starting at an offset (without the newline)
+    string sourceLine(long long offset) const {
+        const char* begin = mappedData + offset;
+        const char* end = (const char*)memchr(begin, '\n', mappedSize - offset);
+        if (end == nullptr) end = mappedData + mappedSize;
+        return string(begin, end - begin);
+    }
+    
+    // Parse the fields of a lazily loaded person that are not part of the sidecar
+    void materialize(TreeNode* node) const {
+        Person& p = node->data;
+        if (p.sourceOffset < 0) return;
+        
+        string fields[10];
+        bool ok = splitRecord(sourceLine(p.sourceOffset), fields, 10) >= 10 &&
+                  fields[0] == p.lastName && fields[1] == p.firstName;
+        if (ok) {
+            try {
+                p.birthYear = stoi(fields[4]);
+                p.birthMonth = stoi(fields[5]);
+                p.birthDay = stoi(fields[6]);
+                p.balance = stod(fields[8]);
+                p.state = fields[2];
+                p.zipCode = fields[3];
+                p.password = fields[7];
+            } catch (const exception& e) {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            // Saving blank fields would drop the record on the next load, so saves are
+            // refused until it is deleted
+            cout << "WARNING: Cannot read record of " << p.firstName << " " << p.lastName 
+                 << " from data file" << endl;
+            p.sourceOffset = RECORD_UNREADABLE;
+            unreadableRecords++;
+            return;
+        }
+        p.sourceOffset = -1;
+    }
+    
+    // Parse a lazily loaded person if needed; false if the record could not be read
+    bool readable(TreeNode* node) const {
+        materialize(node);
+        return node->data.sourceOffset != RECORD_UNREADABLE;
+    }
+    
+    // Display all person information (nothing for a record that could not be read)
+    void displayPersonInfo(TreeNode* node) const {
+        if (!readable(node)) return;
+        const Person& p = node->data;
         cout << p.lastName << " " << p.firstName << " " << p.state << " " 
              << p.zipCode << " " << p.birthYear << " " << p.birthMonth << " " 
              << p.birthDay << " " << p.password << " " << p.balance << " " 
@@ -361,25 +1570,30 @@ private:
         if (node == nullptr) return;
         
         displayAllPersons(node->left);    // Process left subtree
-        displayPersonInfo(node->data);    // Process current node
+        displayPersonInfo(node);          // Process current node
         displayAllPersons(node->right);   // Process right subtree
     }
     
-    // Find oldest person by comparing birth dates
-    void findOldestPerson(TreeNode* node, Person& oldest) const {
+    // Find oldest person by comparing birth dates (unreadable records have none)
+    void findOldestPerson(TreeNode* node, TreeNode*& oldest) const {
         if (node == nullptr) return;
         
         findOldestPerson(node->left, oldest);  // Check left subtree
         
         // Compare birth dates to find oldest
-        if (node->data.birthYear < oldest.birthYear) {
-            oldest = node->data;
-        } else if (node->data.birthYear == oldest.birthYear) {
-            if (node->data.birthMonth < oldest.birthMonth) {
-                oldest = node->data;
-            } else if (node->data.birthMonth == oldest.birthMonth) {
-                if (node->data.birthDay < oldest.birthDay) {
-                    oldest = node->data;
+        if (readable(node)) {
+            const Person& p = node->data;
+            if (oldest == nullptr) {
+                oldest = node;
+            } else if (p.birthYear < oldest->data.birthYear) {
+                oldest = node;
+            } else if (p.birthYear == oldest->data.birthYear) {
+                if (p.birthMonth < oldest->data.birthMonth) {
+                    oldest = node;
+                } else if (p.birthMonth == oldest->data.birthMonth) {
+                    if (p.birthDay < oldest->data.birthDay) {
+                        oldest = node;
+                    }
                 }
             }
         }
@@ -387,20 +1601,209 @@ private:
         findOldestPerson(node->right, oldest); // Check right subtree
     }
     
-    // Save all persons to file (in-order traversal)
-    void saveToFile(TreeNode* node, ofstream& outFile) const {
+    // Append the sidecar entry of a person whose record starts at offset
+    void writeSidecarEntry(ostream& out, const Person& p, unsigned long long offset) const {
+        unsigned short lastLength = (unsigned short)p.lastName.length();
+        unsigned short firstLength = (unsigned short)p.firstName.length();
+        unsigned short ssnLength = (unsigned short)p.ssn.length();
+        
+        out.write((const char*)&offset, sizeof(offset));
+        out.write((const char*)&lastLength, sizeof(lastLength));
+        out.write((const char*)&firstLength, sizeof(firstLength));
+        out.write((const char*)&ssnLength, sizeof(ssnLength));
+        out.write(p.lastName.data(), lastLength);
+        out.write(p.firstName.data(), firstLength);
+        out.write(p.ssn.data(), ssnLength);
+    }
+    
+    // Write sidecar entries for persons that are still at their original offsets
+    void writeSidecarEntries(TreeNode* node, ostream& out) const {
+        if (node == nullptr) return;
+        
+        writeSidecarEntries(node->left, out);
+        writeSidecarEntry(out, node->data, node->data.sourceOffset);
+        writeSidecarEntries(node->right, out);
+    }
+    
+    // Write one person as a data file line
+    static void writeRecord(ostream& out, const Person& p) {
+        out << p.lastName << " " << p.firstName << " " 
+            << p.state << " " << p.zipCode << " " 
+            << p.birthYear << " " << p.birthMonth << " " 
+            << p.birthDay << " " << p.password << " " 
+            << p.balance << " " << p.ssn << '\n';
+    }
+    
+    // Save all persons to file (in-order traversal). In lazy mode records never parsed
+    // are copied verbatim, and sidecar entries (if any) are written at the same time,
+    // with offset tracking the position in the data file.
+    void saveToFile(TreeNode* node, ofstream& outFile, SaveProgress* progress,
+                    ostream* sidecar, unsigned long long& offset) const {
         if (node == nullptr) return;
         
-        saveToFile(node->left, outFile);  // Save left subtree
+        saveToFile(node->left, outFile, progress, sidecar, offset);  // Save left subtree
         
-        // Write current person to file
-        outFile << node->data.lastName << " " << node->data.firstName << " " 
-                << node->data.state << " " << node->data.zipCode << " " 
-                << node->data.birthYear << " " << node->data.birthMonth << " " 
-                << node->data.birthDay << " " << node->data.password << " " 
-                << node->data.balance << " " << node->data.ssn << endl;
+        if (lazyMode) {
+            string record;
+            if (node->data.sourceOffset >= 0) {
+                record = sourceLine(node->data.sourceOffset) + "\n";
+            } else {
+                ostringstream text;
+                writeRecord(text, node->data);
+                record = text.str();
+            }
+            
+            if (sidecar != nullptr) writeSidecarEntry(*sidecar, node->data, offset);
+            offset += record.length();
+            outFile << record;
+        } else {
+            // Write current person to file
+            writeRecord(outFile, node->data);
+        }
+        
+        if (progress != nullptr) {
+            progress->recordsWritten.fetch_add(1, memory_order_relaxed);
+        }
         
-        saveToFile(node->right, outFile); // Save right subtree
+        saveToFile(node->right, outFile, progress, sidecar, offset); // Save right subtree
+    }
+
+#ifdef PERSONDB_POSIX
+    // Copy the size, inode and modification time of a data file into a sidecar header
+    static void stampSignature(const struct stat& info, SidecarHeader& header) {
+        header.dataSize = (long long)info.st_size;
+        header.dataInode = (long long)info.st_ino;
+#ifdef __APPLE__
+        header.dataTime = (long long)info.st_mtimespec.tv_sec * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+        header.dataTime = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+    }
+#endif
+    
+    // Signature of a file, used to match a sidecar to its data file
+    static bool fileSignature(const string& filename, SidecarHeader& header) {
+#ifdef PERSONDB_POSIX
+        struct stat info;
+        if (stat(filename.c_str(), &info) != 0) return false;
+        stampSignature(info, header);
+        return true;
+#else
+        (void)filename; (void)header;
+        return false;
+#endif
+    }
+
+#ifdef PERSONDB_POSIX
+    // Flush a file or directory to stable storage
+    static bool syncPath(const string& path, bool directory) {
+        int fd = open(path.c_str(), directory ? O_RDONLY : O_WRONLY);
+        if (fd < 0) return false;
+        bool ok = fsync(fd) == 0;
+        close(fd);
+        return ok;
+    }
+    
+    // Directory holding a file, so a rename inside it can be made durable
+    static string directoryOf(const string& filename) {
+        size_t slash = filename.rfind('/');
+        if (slash == string::npos) return ".";
+        if (slash == 0) return "/";
+        return filename.substr(0, slash);
+    }
+#endif
+    
+    // Write all persons to a temporary file, then atomically rename it over the target
+    bool writeSnapshot(const string& filename, SaveProgress* progress) const {
+        string tempName = filename + ".tmp";
+        
+        // Large stream buffer so the file is written in big sequential chunks
+        const size_t bufferSize = 1 << 20;
+        char* buffer = new char[bufferSize];
+        
+        ofstream outFile;
+        outFile.rdbuf()->pubsetbuf(buffer, bufferSize);
+        outFile.open(tempName);
+        
+        // Lazy mode keeps the sidecar in step with every saved data file
+        string sidecarTemp = filename + ".idx.tmp";
+        ofstream sidecar;
+        ostream* sidecarOut = nullptr;
+        SidecarHeader header;
+        if (lazyMode) {
+            sidecar.open(sidecarTemp, ios::binary);
+            if (sidecar.is_open()) {
+                memset(&header, 0, sizeof(header));
+                sidecar.write((const char*)&header, sizeof(header));
+                sidecarOut = &sidecar;
+            }
+        }
+        
+        bool ok = outFile.is_open();
+        if (ok) {
+            long long total = (long long)people.size();
+            if (progress != nullptr) {
+                progress->recordsTotal.store(total);
+            }
+            unsigned long long offset = 0;
+            saveToFile(people.root(), outFile, progress, sidecarOut, offset);
+            outFile.close();
+            ok = !outFile.fail();
+#ifdef PERSONDB_POSIX
+            // The data must be on disk before the rename can replace the old file
+            if (ok) ok = syncPath(tempName, false);
+#endif
+            
+            // The header records which data file the sidecar belongs to
+            if (ok && sidecarOut != nullptr) {
+                memcpy(header.magic, "PDBIDX02", 8);
+                header.recordCount = total;
+                bool stamped = fileSignature(tempName, header);
+                sidecar.seekp(0);
+                sidecar.write((const char*)&header, sizeof(header));
+                sidecar.close();
+                if (!stamped || sidecar.fail()) sidecarOut = nullptr;
+#ifdef PERSONDB_POSIX
+                if (sidecarOut != nullptr && !syncPath(sidecarTemp, false)) sidecarOut = nullptr;
+#endif
+            }
+        }
+        delete[] buffer;
+        
+        if (ok && rename(tempName.c_str(), filename.c_str()) != 0) ok = false;
+        if (!ok) remove(tempName.c_str());
+        
+        if (sidecar.is_open()) sidecar.close();
+        if (lazyMode) {
+            string sidecarName = filename + ".idx";
+            if (!ok || sidecarOut == nullptr || rename(sidecarTemp.c_str(), sidecarName.c_str()) != 0) {
+                remove(sidecarTemp.c_str());
+            }
+        }
+#ifdef PERSONDB_POSIX
+        // Make the renames themselves survive a power loss
+        if (ok) ok = syncPath(directoryOf(filename), true);
+#endif
+        return ok;
+    }
+    
+    // Collect a finished background save (wait = true blocks until it ends)
+    void reapBackgroundSave(bool wait) {
+#ifdef PERSONDB_POSIX
+        if (saveChild == 0) return;
+        
+        int status = 0;
+        pid_t result = waitpid(saveChild, &status, wait ? 0 : WNOHANG);
+        if (result == 0) return;  // Still running
+        
+        saveChild = 0;
+        
+        // A writer that crashed or could not write the file counts as failed
+        bool ok = result > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        saveProgress->state.store(ok ? SAVE_DONE : SAVE_FAILED);
+#else
+        (void)wait;
+#endif
     }
     
     // Find all persons with given last name using custom comparison
@@ -421,7 +1824,7 @@ private:
         // Last names match - display and search both subtrees
         else {
             findByLastName(node->left, lastName);  // Check left for more matches
-            displayPersonInfo(node->data);         // Display current match
+            displayPersonInfo(node);               // Display current match
             findByLastName(node->right, lastName); // Check right for more matches
         }
     }
@@ -437,55 +1840,215 @@ private:
         
         // Display if first name matches exactly
         if (firstCompare == 0) {
-            displayPersonInfo(node->data);
+            displayPersonInfo(node);
+        }
+        
+        findByFirstName(node->right, firstName); // Check right subtree
+    }
+    
+    // Score every person in a subtree (used when trigrams cannot narrow the search)
+    void collectFuzzyMatches(TreeNode* node, const NameMatcher& matcher, int maxDistance,
+                             vector<pair<int, TreeNode*> >& matches) const {
+        if (node == nullptr) return;
+        
+        collectFuzzyMatches(node->left, matcher, maxDistance, matches);
+        
+        int dist = matcher.distance(node->data, maxDistance);
+        if (dist <= maxDistance) matches.push_back(make_pair(dist, node));
+        
+        collectFuzzyMatches(node->right, matcher, maxDistance, matches);
+    }
+    
+    // Add a newly inserted person to the secondary indexes
+    void indexNewPerson(TreeNode* created) {
+        if (trigramIndexReady) trigramIndex.add(created);
+        if (columnsReady) {
+            materialize(created);
+            columns.addRow(created);
+        }
+        
+        // Flag SSNs shared by two people; every holder stays indexed
+        unsigned long long key;
+        if (!ssnKey(created->data, key)) return;
+        
+        TreeNode* holder = ssnIndex.insert(key, created);
+        if (holder != nullptr) {
+            cout << "WARNING: Duplicate SSN " << created->data.ssn << " for " 
+                 << created->data.firstName << " " << created->data.lastName 
+                 << " (already used by " << holder->data.firstName << " " 
+                 << holder->data.lastName << ")" << endl;
+        }
+    }
+    
+    // Parse one data file line and insert the person. With a source offset only the
+    // name and SSN are kept; the rest is parsed again from the mapped file when needed.
+    bool addRecordLine(const string& line, long long sourceOffset) {
+        // Parse the line into data fields
+        string fields[10];
+        int fieldIndex = splitRecord(line, fields, 10);
+        
+        // Create person if we got all 10 fields
+        if (fieldIndex < 10) {
+            cout << "WARNING: Skipping incomplete record: " << line << endl;
+            return false;
+        }
+        
+        try {
+            int year = stoi(fields[4]);
+            int month = stoi(fields[5]);
+            int day = stoi(fields[6]);
+            double bal = stod(fields[8]);
+            
+            TreeNode* created;
+            if (sourceOffset >= 0) {
+                Person keyOnly(fields[0], fields[1], "", "", 0, 0, 0, "", 0, fields[9]);
+                keyOnly.sourceOffset = sourceOffset;
+                created = people.insert(keyOnly);
+            } else {
+                Person newPerson(fields[0], fields[1], fields[2], fields[3],
+                               year, month, day, fields[7], bal, fields[9]);
+                created = people.insert(newPerson);
+            }
+            
+            if (created == nullptr) {
+                cout << "WARNING: Skipping duplicate name: " << line << endl;
+                return false;
+            }
+            indexNewPerson(created);
+            return true;
+        } catch (const exception& e) {
+            cout << "WARNING: Skipping invalid record: " << line << endl;
+            return false;
         }
-        
-        findByFirstName(node->right, firstName); // Check right subtree
     }
     
-    // Check if tree is balanced and get height
-    void checkTreeBalance(TreeNode* node, bool& isBalanced, int& height) const {
-        if (node == nullptr) {
-            isBalanced = true;
-            height = 0;
-            return;
+    // Build the tree from a sidecar index that matches the data file. Returns the
+    // number of persons loaded, or -1 (with nothing loaded) if it cannot be used.
+    long long loadSidecar(const string& sidecarName, const SidecarHeader& expected) {
+#ifdef PERSONDB_POSIX
+        int fd = open(sidecarName.c_str(), O_RDONLY);
+        if (fd < 0) return -1;
+        
+        struct stat info;
+        void* mapping = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(SidecarHeader)) {
+            mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
         }
+        close(fd);
+        if (mapping == MAP_FAILED) return -1;
+        
+        const char* data = (const char*)mapping;
+        size_t size = info.st_size;
+        SidecarHeader header;
+        memcpy(&header, data, sizeof(header));
+        
+        bool ok = memcmp(header.magic, "PDBIDX02", 8) == 0 && header.dataSize == expected.dataSize &&
+                  header.dataTime == expected.dataTime && header.dataInode == expected.dataInode &&
+                  header.recordCount >= 0;
+        
+        // Entries are in name order, so the nodes can be linked as a balanced tree directly
+        vector<TreeNode*> nodes;
+        size_t position = sizeof(header);
+        for (long long i = 0; ok && i < header.recordCount; i++) {
+            unsigned long long offset;
+            unsigned short lengths[3];
+            ok = position + sizeof(offset) + sizeof(lengths) <= size;
+            if (!ok) break;
+            memcpy(&offset, data + position, sizeof(offset));
+            memcpy(lengths, data + position + sizeof(offset), sizeof(lengths));
+            position += sizeof(offset) + sizeof(lengths);
+            
+            ok = position + lengths[0] + lengths[1] + lengths[2] <= size && offset < mappedSize;
+            if (!ok) break;
+            string last(data + position, lengths[0]);
+            string first(data + position + lengths[0], lengths[1]);
+            string ssn(data + position + lengths[0] + lengths[1], lengths[2]);
+            position += lengths[0] + lengths[1] + lengths[2];
+            
+            Person keyOnly(last, first, "", "", 0, 0, 0, "", 0, ssn);
+            keyOnly.sourceOffset = (long long)offset;
+            nodes.push_back(people.createNode(keyOnly));
+        }
+        munmap(mapping, size);
         
-        bool leftBalanced, rightBalanced;
-        int leftHeight, rightHeight;
-        
-        // Check balance of left and right subtrees
-        checkTreeBalance(node->left, leftBalanced, leftHeight);
-        checkTreeBalance(node->right, rightBalanced, rightHeight);
-        
-        // Current node is balanced if both subtrees are balanced and height difference <= 1
-        int diff = leftHeight - rightHeight;
-        if (diff < 0) diff = -diff;
+        if (ok) ok = people.linkSorted(nodes);
+        if (!ok) {
+            for (size_t i = 0; i < nodes.size(); i++) people.destroyNode(nodes[i]);
+            return -1;
+        }
         
-        isBalanced = leftBalanced && rightBalanced && (diff <= 1);
+        for (size_t i = 0; i < nodes.size(); i++) indexNewPerson(nodes[i]);
+        return (long long)nodes.size();
+#else
+        (void)sidecarName; (void)expected;
+        return -1;
+#endif
+    }
+    
+    // Add every person in a subtree to the trigram index
+    void addTrigrams(TreeNode* node) {
+        if (node == nullptr) return;
         
-        // Height is 1 + tallest subtree height
-        if (leftHeight > rightHeight) 
-            height = 1 + leftHeight;
-        else
-            height = 1 + rightHeight;
+        addTrigrams(node->left);
+        trigramIndex.add(node);
+        addTrigrams(node->right);
     }
     
-    // Free all memory used by the tree
-    void deleteEntireTree(TreeNode* node) {
+    // Add every person in a subtree to the columnar mirror
+    void addColumnRows(TreeNode* node) {
         if (node == nullptr) return;
         
-        deleteEntireTree(node->left);   // Delete left subtree
-        deleteEntireTree(node->right);  // Delete right subtree
-        delete node;                    // Delete current node
+        addColumnRows(node->left);
+        if (readable(node)) columns.addRow(node);
+        addColumnRows(node->right);
+    }
+    
+    // Keep only the rows of the bitmap that pass one WHERE condition
+    void applyFilter(const QueryFilter& filter, unsigned long long* bitmap) const {
+        switch (filter.op) {
+            case OP_EQ: columns.filter<OP_EQ>(filter.column, filter.value, bitmap); break;
+            case OP_NE: columns.filter<OP_NE>(filter.column, filter.value, bitmap); break;
+            case OP_LT: columns.filter<OP_LT>(filter.column, filter.value, bitmap); break;
+            case OP_LE: columns.filter<OP_LE>(filter.column, filter.value, bitmap); break;
+            case OP_GT: columns.filter<OP_GT>(filter.column, filter.value, bitmap); break;
+            default: columns.filter<OP_GE>(filter.column, filter.value, bitmap); break;
+        }
+    }
+    
+    // Text of one aggregate value
+    static string formatAggregate(const QueryItem& item, double value) {
+        ostringstream text;
+        if (item.function == AGG_AVG || item.column == COL_BALANCE) {
+            text.setf(ios::fixed);
+            text.precision(2);
+            text << value;
+        } else {
+            text << (long long)value;
+        }
+        return text.str();
     }
 
 public:
     // Constructor - initialize empty tree
-    PersonDatabase() : root(nullptr) {}
+    PersonDatabase() : trigramIndexReady(true), columnsReady(false), lazyMode(false), mappedData(nullptr),
+                       unreadableRecords(0), mappedSize(0), saveProgress(nullptr) {
+#ifdef PERSONDB_POSIX
+        saveChild = 0;
+        
+        // Progress lives in shared memory so the forked writer can update it
+        void* shared = mmap(nullptr, sizeof(SaveProgress), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared != MAP_FAILED) {
+            saveProgress = new (shared) SaveProgress();
+        }
+#endif
+    }
     
     // Load person data from file into tree
     bool loadFromFile(const string& filename) {
+        // Bulk loads replace nodes wholesale, so nothing cached may survive them
+        lookupCache.clear();
+        
         ifstream inputFile(filename);
         if (!inputFile.is_open()) {
             cout << "ERROR: Cannot open data file " << filename << endl;
@@ -500,51 +2063,7 @@ public:
             // Skip empty lines
             if (line.empty()) continue;
             
-            // Parse the line into data fields
-            string fields[10];
-            int fieldIndex = 0;
-            string currentField = "";
-            
-            for (size_t i = 0; i < line.length(); i++) {
-                char c = line[i];
-                if (c == ' ') {
-                    if (!currentField.empty()) {
-                        if (fieldIndex < 10) {
-                            fields[fieldIndex] = currentField;
-                            fieldIndex++;
-                        }
-                        currentField = "";
-                    }
-                } else {
-                    currentField += c;
-                }
-            }
-            
-            // Add last field
-            if (!currentField.empty() && fieldIndex < 10) {
-                fields[fieldIndex] = currentField;
-                fieldIndex++;
-            }
-            
-            // Create person if we got all 10 fields
-            if (fieldIndex == 10) {
-                try {
-                    int year = stoi(fields[4]);
-                    int month = stoi(fields[5]);
-                    int day = stoi(fields[6]);
-                    double bal = stod(fields[8]);
-                    
-                    Person newPerson(fields[0], fields[1], fields[2], fields[3],
-                                   year, month, day, fields[7], bal, fields[9]);
-                    
-                    root = insertPerson(root, newPerson);
-                    recordCount++;
-                } catch (const exception& e) {
-                    cout << "WARNING: Skipping invalid record: " << line << endl;
-                }
-            } else {
-                cout << "WARNING: Skipping incomplete record: " << line << endl;
-            }
+            if (addRecordLine(line, -1)) recordCount++;
         }
         
         inputFile.close();
@@ -552,96 +2071,524 @@ public:
         return true;
     }
     
+    // Fast start: map the data file and load only names and SSNs, from the sidecar
+    // index when it matches the file. Other fields are parsed when first needed.
+    bool loadLazily(const string& filename) {
+#ifdef PERSONDB_POSIX
+        lookupCache.clear();
+        
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            cout << "ERROR: Cannot open data file " << filename << endl;
+            return false;
+        }
+        
+        struct stat info;
+        void* mapping = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            cout << "WARNING: Cannot map data file, loading every record" << endl;
+            return loadFromFile(filename);
+        }
+        
+        mappedData = (const char*)mapping;
+        mappedSize = info.st_size;
+        lazyMode = true;
+        
+        // Fuzzy search is rarely the first command, so its index waits until FUZZY
+        trigramIndexReady = false;
+        
+        string sidecarName = filename + ".idx";
+        SidecarHeader header;
+        memcpy(header.magic, "PDBIDX02", 8);
+        stampSignature(info, header);
+        long long recordCount = loadSidecar(sidecarName, header);
+        if (recordCount >= 0) {
+            cout << "SUCCESS: Loaded " << recordCount << " person keys from " << sidecarName << endl;
+            return true;
+        }
+        
+        // No usable sidecar - scan the mapped file for keys and write one for next time
+        recordCount = 0;
+        size_t position = 0;
+        while (position < mappedSize) {
+            const char* begin = mappedData + position;
+            const char* end = (const char*)memchr(begin, '\n', mappedSize - position);
+            if (end == nullptr) end = mappedData + mappedSize;
+            
+            string line(begin, end - begin);
+            if (!line.empty() && addRecordLine(line, (long long)position)) recordCount++;
+            position = (end - mappedData) + 1;
+        }
+        cout << "SUCCESS: Loaded " << recordCount << " person keys" << endl;
+        
+        string sidecarTemp = sidecarName + ".tmp";
+        ofstream sidecar(sidecarTemp, ios::binary);
+        header.recordCount = recordCount;
+        sidecar.write((const char*)&header, sizeof(header));
+        writeSidecarEntries(people.root(), sidecar);
+        sidecar.close();
+        if (sidecar.fail() || !syncPath(sidecarTemp, false) ||
+            rename(sidecarTemp.c_str(), sidecarName.c_str()) != 0) {
+            remove(sidecarTemp.c_str());
+            cout << "WARNING: Cannot write sidecar index " << sidecarName << endl;
+        }
+        return true;
+#else
+        cout << "WARNING: Lazy loading needs a POSIX system, loading every record" << endl;
+        return loadFromFile(filename);
+#endif
+    }
+    
+    // Tell the user a person exists but their record could not be read
+    void reportUnreadable(TreeNode* node) const {
+        cout << "PERSON UNREADABLE: " << node->data.firstName << " " << node->data.lastName
+             << " (record could not be read from data file)" << endl;
+    }
+    
     // Find and display a specific person
     void findPersonByName(const string& first, const string& last) {
-        TreeNode* result = findPerson(root, first, last);
-        if (result != nullptr) {
+        TreeNode* result = findPerson(first, last);
+        if (result != nullptr && !readable(result)) {
+            reportUnreadable(result);
+        } else if (result != nullptr) {
             cout << "FOUND: ";
-            displayPersonInfo(result->data);
+            displayPersonInfo(result);
         } else {
             cout << "PERSON NOT FOUND: " << first << " " << last << endl;
         }
     }
     
+    // Find and display every person with a given SSN
+    void findPersonBySSN(const string& ssn) {
+        unsigned long long key;
+        vector<TreeNode*> holders;
+        if (parseSSN(ssn, key)) ssnIndex.findAll(key, holders);
+        
+        if (holders.empty()) {
+            cout << "SSN NOT FOUND: " << ssn << endl;
+            return;
+        }
+        for (size_t i = 0; i < holders.size(); i++) {
+            if (!readable(holders[i])) {
+                reportUnreadable(holders[i]);
+                continue;
+            }
+            cout << "FOUND: ";
+            displayPersonInfo(holders[i]);
+        }
+    }
+    
+    // Display the closest names within maxDistance edits of a possibly misspelled name
+    void findPersonsByFuzzyName(const string& first, const string& last, int maxDistance) {
+        const size_t maxResults = 10;
+        NameMatcher matcher(first, last);
+        vector<pair<int, TreeNode*> > matches;
+        
+        // Lazy loading leaves the trigram index to the first fuzzy search
+        if (!trigramIndexReady) {
+            addTrigrams(people.root());
+            trigramIndexReady = true;
+        }
+        
+        vector<TreeNode*> candidates;
+        if (trigramIndex.candidates(matcher.name(), maxDistance, candidates)) {
+            for (size_t i = 0; i < candidates.size(); i++) {
+                int dist = matcher.distance(candidates[i]->data, maxDistance);
+                if (dist <= maxDistance) matches.push_back(make_pair(dist, candidates[i]));
+            }
+        } else {
+            collectFuzzyMatches(people.root(), matcher, maxDistance, matches);
+        }
+        
+        // Records that could not be read have nothing to show
+        matches.erase(remove_if(matches.begin(), matches.end(),
+                                [this](const pair<int, TreeNode*>& match) { return !readable(match.second); }),
+                      matches.end());
+        if (matches.empty()) {
+            cout << "NO FUZZY MATCHES: " << first << " " << last << endl;
+            return;
+        }
+        
+        // Closest first, then in name order
+        NameCompare compare;
+        size_t shown = min(maxResults, matches.size());
+        partial_sort(matches.begin(), matches.begin() + shown, matches.end(),
+                     [&compare](const pair<int, TreeNode*>& a, const pair<int, TreeNode*>& b) {
+                         if (a.first != b.first) return a.first < b.first;
+                         return compare(PersonNameKey()(a.second->data),
+                                        PersonNameKey()(b.second->data)) < 0;
+                     });
+        
+        cout << "Closest matches for: " << first << " " << last << endl;
+        for (size_t i = 0; i < shown; i++) {
+            cout << "DISTANCE " << matches[i].first << ": ";
+            displayPersonInfo(matches[i].second);
+        }
+    }
+    
     // Display all persons with given last name
     void findPersonsByLastName(const string& lastName) {
         cout << "Searching for last name: " << lastName << endl;
-        findByLastName(root, lastName);
+        findByLastName(people.root(), lastName);
     }
     
     // Display all persons with given first name
     void findPersonsByFirstName(const string& firstName) {
         cout << "Searching for first name: " << firstName << endl;
-        findByFirstName(root, firstName);
+        findByFirstName(people.root(), firstName);
     }
     
     // Display all persons in sorted order
     void displayAllRecords() {
-        if (root == nullptr) {
+        if (people.root() == nullptr) {
             cout << "DATABASE IS EMPTY" << endl;
             return;
         }
         cout << "ALL RECORDS:" << endl;
         cout << "------------" << endl;
-        displayAllPersons(root);
+        displayAllPersons(people.root());
     }
     
     // Find and display the oldest person
     void findOldestPersonInDatabase() {
-        if (root == nullptr) {
+        if (people.root() == nullptr) {
             cout << "DATABASE IS EMPTY" << endl;
             return;
         }
         
-        Person oldest = root->data;
-        findOldestPerson(root, oldest);
+        TreeNode* oldestNode = nullptr;
+        findOldestPerson(people.root(), oldestNode);
+        if (oldestNode == nullptr) {
+            cout << "NO READABLE RECORDS: Birth dates could not be read from data file" << endl;
+            return;
+        }
         
+        const Person& oldest = oldestNode->data;
         cout << "OLDEST PERSON: " << oldest.firstName << " " << oldest.lastName 
              << " from " << oldest.state << " (Zip: " << oldest.zipCode 
              << ") Born: " << oldest.birthYear << "-" << oldest.birthMonth 
              << "-" << oldest.birthDay << endl;
     }
     
-    // Save all records to file
-    void saveToFile(const string& filename) {
-        ofstream outputFile(filename);
-        if (!outputFile.is_open()) {
+    // Refuse to save while some lazily loaded record could not be read back
+    bool checkSaveable() const {
+        if (unreadableRecords == 0) return true;
+        
+        cout << "ERROR: " << unreadableRecords << " record(s) could not be read from the data file; "
+             << "not saving (DELETE them to allow saving)" << endl;
+        return false;
+    }
+    
+    // Save all records to file, blocking until the write is complete; false if nothing
+    // was saved
+    bool saveToFile(const string& filename) {
+        // Never race a background writer for the same temporary file
+        reapBackgroundSave(true);
+        
+        if (!checkSaveable()) return false;
+        if (!writeSnapshot(filename, nullptr)) {
             cout << "ERROR: Cannot create output file " << filename << endl;
-            return;
+            return false;
         }
-        
-        saveToFile(root, outputFile);
-        outputFile.close();
         cout << "SUCCESS: Database saved to " << filename << endl;
+        return true;
+    }
+    
+    // Save a point-in-time snapshot of all records without stalling the command loop
+    void saveInBackground(const string& filename) {
+        if (!checkSaveable()) return;
+
+#ifdef PERSONDB_POSIX
+        if (saveProgress != nullptr) {
+            reapBackgroundSave(false);
+            if (saveChild != 0) {
+                cout << "SAVE ALREADY IN PROGRESS: Use SAVESTATUS to follow it" << endl;
+                return;
+            }
+            
+            saveProgress->recordsWritten.store(0);
+            saveProgress->recordsTotal.store((long long)people.size());
+            saveProgress->state.store(SAVE_RUNNING);
+            saveTarget = filename;
+            
+            // The child gets a copy-on-write image of the tree exactly as it is now
+            pid_t child = fork();
+            if (child == 0) {
+                bool ok = writeSnapshot(filename, saveProgress);
+                _exit(ok ? 0 : 1);
+            }
+            if (child > 0) {
+                saveChild = child;
+                cout << "BACKGROUND SAVE STARTED: Writing to " << filename << endl;
+                return;
+            }
+            saveProgress->state.store(SAVE_IDLE);
+        }
+#endif
+        cout << "WARNING: Background save unavailable, saving in foreground" << endl;
+        saveToFile(filename);
+    }
+    
+    // Report progress of the most recent background save
+    void reportSaveStatus() {
+        reapBackgroundSave(false);
+        
+        int state = SAVE_IDLE;
+        long long written = 0, total = 0;
+        if (saveProgress != nullptr) {
+            state = saveProgress->state.load();
+            written = saveProgress->recordsWritten.load();
+            total = saveProgress->recordsTotal.load();
+        }
+        
+        if (state == SAVE_RUNNING) {
+            long long percent = 0;
+            if (total > 0) percent = written * 100 / total;
+            cout << "SAVE STATUS: In progress - " << written << " of " << total
+                 << " records written (" << percent << "%)" << endl;
+        } else if (state == SAVE_DONE) {
+            cout << "SAVE STATUS: Completed - " << written << " records saved to "
+                 << saveTarget << endl;
+        } else if (state == SAVE_FAILED) {
+            cout << "SAVE STATUS: Failed - cannot write " << saveTarget << endl;
+        } else {
+            cout << "SAVE STATUS: No background save has been started" << endl;
+        }
+    }
+    
+    // Block until a running background save has finished
+    void waitForBackgroundSave() {
+        reapBackgroundSave(true);
     }
     
     // Update a person's zip code
     void updatePersonZipCode(const string& first, const string& last, const string& newZip) {
-        TreeNode* personNode = findPerson(root, first, last);
+        TreeNode* personNode = findPerson(first, last);
         if (personNode != nullptr) {
+            materialize(personNode);
             personNode->data.zipCode = newZip;
+            if (columnsReady) columns.updateZip(personNode);
             cout << "UPDATED: " << first << " " << last << " now lives in zip code " << newZip << endl;
         } else {
             cout << "PERSON NOT FOUND: " << first << " " << last << endl;
         }
     }
     
+    // Update a person's SSN, refusing one that already belongs to someone else
+    void updatePersonSSN(const string& first, const string& last, const string& newSSN) {
+        unsigned long long key;
+        if (!parseSSN(newSSN, key)) {
+            cout << "INVALID SSN: " << newSSN << " (digits and dashes only)" << endl;
+            return;
+        }
+        
+        TreeNode* personNode = findPerson(first, last);
+        if (personNode == nullptr) {
+            cout << "PERSON NOT FOUND: " << first << " " << last << endl;
+            return;
+        }
+        
+        vector<TreeNode*> holders;
+        ssnIndex.findAll(key, holders);
+        for (size_t i = 0; i < holders.size(); i++) {
+            if (holders[i] == personNode) continue;
+            cout << "SSN ALREADY IN USE: " << newSSN << " belongs to " 
+                 << holders[i]->data.firstName << " " << holders[i]->data.lastName << endl;
+            return;
+        }
+        
+        // Saving copies unparsed records verbatim, so parse before changing anything
+        materialize(personNode);
+        unsigned long long oldKey;
+        if (ssnKey(personNode->data, oldKey)) ssnIndex.erase(oldKey, personNode);
+        personNode->data.ssn = newSSN;
+        ssnIndex.insert(key, personNode);
+        cout << "UPDATED: " << first << " " << last << " now has SSN " << newSSN << endl;
+    }
+    
     // Remove a person from database
     void removePerson(const string& first, const string& last) {
-        TreeNode* personNode = findPerson(root, first, last);
+        TreeNode* personNode = findPerson(first, last);
         if (personNode != nullptr) {
-            root = deletePerson(root, first, last);
+            unsigned long long key;
+            if (ssnKey(personNode->data, key)) ssnIndex.erase(key, personNode);
+            if (personNode->data.sourceOffset == RECORD_UNREADABLE) unreadableRecords--;
+            if (trigramIndexReady) trigramIndex.remove(personNode);
+            if (columnsReady) columns.removeRow(personNode);
+            lookupCache.forget(personNode);
+            people.erase(NameKey(last, first));
             cout << "DELETED: " << first << " " << last << endl;
         } else {
             cout << "PERSON NOT FOUND: " << first << " " << last << endl;
         }
     }
     
+    // Run a parsed SELECT over the columnar mirror
+    void runQuery(const Query& query) {
+        // Built on first use; after that mutations keep it in step with the tree
+        if (!columnsReady) {
+            addColumnRows(people.root());
+            columnsReady = true;
+        }
+        
+        // Every WHERE condition narrows one bitmap of selected rows
+        size_t rows = columns.size();
+        vector<unsigned long long> bitmap((rows + 63) / 64, ~0ULL);
+        if (rows % 64 != 0) bitmap.back() = (1ULL << (rows % 64)) - 1;
+        for (size_t i = 0; i < query.filters.size(); i++) {
+            applyFilter(query.filters[i], bitmap.data());
+        }
+        
+        size_t limit = rows;
+        if (query.limit >= 0 && (unsigned long long)query.limit < rows) limit = (size_t)query.limit;
+        
+        if (query.allColumns) {
+            vector<size_t> selected;
+            forEachSelected(bitmap.data(), rows, [&](size_t row) {
+                selected.push_back(row);
+            });
+            
+            // Requested column order with missing values last, ties (and no ORDER BY)
+            // in name order
+            const ColumnStore& store = columns;
+            int column = query.orderColumn;
+            bool descending = query.descending;
+            NameCompare compare;
+            size_t shown = min(limit, selected.size());
+            partial_sort(selected.begin(), selected.begin() + shown, selected.end(),
+                         [&](size_t a, size_t b) {
+                             if (column >= 0) {
+                                 bool knownA = store.known(column, a), knownB = store.known(column, b);
+                                 if (knownA != knownB) return knownA;
+                                 double x = store.value(column, a), y = store.value(column, b);
+                                 if (x != y) return descending ? x > y : x < y;
+                             }
+                             return compare(PersonNameKey()(store.node(a)->data),
+                                            PersonNameKey()(store.node(b)->data)) < 0;
+                         });
+            
+            cout << "MATCHING RECORDS: " << selected.size() << endl;
+            for (size_t i = 0; i < shown; i++) {
+                displayPersonInfo(columns.node(selected[i]));
+            }
+            return;
+        }
+        
+        // GROUP BY STATE totals every state group in one pass per item; without it there
+        // is a single group, aggregated by the SSE2 kernels
+        size_t groupCount = query.groupByState ? columns.groupCount() : 1;
+        vector<long long> counts(groupCount, 0);
+        vector<vector<ColumnTotals> > totals(query.items.size());
+        if (query.groupByState) {
+            columns.countByGroup(bitmap.data(), counts);
+        } else {
+            for (size_t w = 0; w < bitmap.size(); w++) counts[0] += countBits(bitmap[w]);
+        }
+        for (size_t i = 0; i < query.items.size(); i++) {
+            int function = query.items[i].function;
+            if (function == ITEM_STATE || function == AGG_COUNT) continue;
+            
+            if (query.groupByState) {
+                columns.totalsByGroup(query.items[i].column, bitmap.data(), totals[i]);
+            } else {
+                totals[i].resize(1);
+                columns.totals(query.items[i].column, bitmap.data(), totals[i][0]);
+            }
+        }
+        
+        // State code of a group (groups are ordered by it when nothing else decides)
+        const ColumnStore& store = columns;
+        auto groupState = [&](size_t group) -> unsigned short {
+            return query.groupByState ? store.groupState(group) : 0;
+        };
+        
+        // Whether an item has a value for one group (an aggregate over no values is NULL)
+        auto itemKnown = [&](size_t item, size_t group) -> bool {
+            int function = query.items[item].function;
+            return function == ITEM_STATE || function == AGG_COUNT || totals[item][group].count > 0;
+        };
+        
+        // Value of an item for one group (the state code for STATE)
+        auto itemValue = [&](size_t item, size_t group) -> double {
+            int function = query.items[item].function;
+            if (function == ITEM_STATE) return (double)groupState(group);
+            if (function == AGG_COUNT) return (double)counts[group];
+            const ColumnTotals& t = totals[item][group];
+            if (function == AGG_SUM) return t.sum;
+            if (function == AGG_AVG) return t.sum / t.count;
+            if (function == AGG_MIN) return t.min;
+            return t.max;
+        };
+        
+        vector<size_t> groups;
+        for (size_t g = 0; g < groupCount; g++) {
+            if (counts[g] > 0 || !query.groupByState) groups.push_back(g);
+        }
+        
+        // Requested item order with NULLs last, ties (and no ORDER BY) in state order
+        int orderItem = query.orderItem;
+        bool descending = query.descending;
+        size_t shown = min(limit, groups.size());
+        partial_sort(groups.begin(), groups.begin() + shown, groups.end(),
+                     [&](size_t a, size_t b) {
+                         if (orderItem >= 0) {
+                             bool knownA = itemKnown(orderItem, a), knownB = itemKnown(orderItem, b);
+                             if (knownA != knownB) return knownA;
+                             if (!knownA) return groupState(a) < groupState(b);
+                             double x = itemValue(orderItem, a), y = itemValue(orderItem, b);
+                             if (x != y) return descending ? x > y : x < y;
+                         }
+                         return groupState(a) < groupState(b);
+                     });
+        
+        for (size_t i = 0; i < query.items.size(); i++) {
+            cout << (i == 0 ? "" : " ") << query.items[i].label;
+        }
+        cout << endl;
+        for (size_t r = 0; r < shown; r++) {
+            size_t group = groups[r];
+            for (size_t i = 0; i < query.items.size(); i++) {
+                const QueryItem& item = query.items[i];
+                cout << (i == 0 ? "" : " ");
+                if (item.function == ITEM_STATE) {
+                    unsigned short code = groupState(group);
+                    cout << (char)(code >> 8);
+                    if ((code & 0xFF) != 0) cout << (char)(code & 0xFF);
+                } else if (item.function == AGG_COUNT) {
+                    cout << counts[group];
+                } else if (!itemKnown(i, group)) {
+                    cout << "NULL";
+                } else {
+                    cout << formatAggregate(item, itemValue(i, group));
+                }
+            }
+            cout << endl;
+        }
+    }
+    
+    // Report how well the lookup cache is serving name lookups
+    void reportCacheStats() const {
+        unsigned long long hits = lookupCache.hitCount();
+        unsigned long long lookups = hits + lookupCache.missCount();
+        ostringstream rate;
+        rate.setf(ios::fixed);
+        rate.precision(1);
+        rate << (lookups == 0 ? 0.0 : 100.0 * hits / lookups);
+        
+        cout << "CACHE STATS: " << hits << " hits, " << lookupCache.missCount() << " misses ("
+             << rate.str() << "% hit rate), " << lookupCache.entriesUsed() << " of "
+             << lookupCache.capacity() << " entries used" << endl;
+    }
+    
     // Verify tree is balanced
     void verifyTreeBalance() {
         bool isBalanced;
         int height;
-        checkTreeBalance(root, isBalanced, height);
+        people.checkBalance(isBalanced, height);
         
         if (isBalanced) {
             cout << "TREE STATUS: Balanced with height " << height << endl;
@@ -652,7 +2599,17 @@ public:
     
     // Destructor - clean up all memory
     ~PersonDatabase() {
-        deleteEntireTree(root);
+        reapBackgroundSave(true);
+
+#ifdef PERSONDB_POSIX
+        if (saveProgress != nullptr) {
+            saveProgress->~SaveProgress();
+            munmap(saveProgress, sizeof(SaveProgress));
+        }
+        if (mappedData != nullptr) {
+            munmap((void*)mappedData, mappedSize);
+        }
+#endif
     }
 };
 
@@ -690,22 +2647,257 @@ void parseCommand(const string& input, string& command, string& arg1, string& ar
     }
 }
 
+// Upper-case copy of a word, for case-insensitive query keywords
+string upperCase(const string& word) {
+    string result = word;
+    for (char& c : result) {
+        if (c >= 'a' && c <= 'z') {
+            c = c - 'a' + 'A';
+        }
+    }
+    return result;
+}
+
+// Column named in a query (-1 if unknown)
+int queryColumn(const string& name) {
+    if (name == "STATE") return COL_STATE;
+    if (name == "ZIP") return COL_ZIP;
+    if (name == "BIRTHDATE") return COL_BIRTHDATE;
+    if (name == "BIRTHYEAR") return COL_BIRTHYEAR;
+    if (name == "BALANCE") return COL_BALANCE;
+    return -1;
+}
+
+// Parse one SELECT item: STATE, COUNT or SUM/AVG/MIN/MAX(column)
+bool parseQueryItem(const string& word, QueryItem& item) {
+    item.column = -1;
+    item.label = word;
+    if (word == "STATE") {
+        item.function = ITEM_STATE;
+        return true;
+    }
+    if (word == "COUNT" || word == "COUNT(*)") {
+        item.function = AGG_COUNT;
+        item.label = "COUNT";
+        return true;
+    }
+    
+    size_t open = word.find('(');
+    if (open == string::npos || word[word.length() - 1] != ')') return false;
+    string function = word.substr(0, open);
+    if (function == "SUM") item.function = AGG_SUM;
+    else if (function == "AVG") item.function = AGG_AVG;
+    else if (function == "MIN") item.function = AGG_MIN;
+    else if (function == "MAX") item.function = AGG_MAX;
+    else return false;
+    
+    item.column = queryColumn(word.substr(open + 1, word.length() - open - 2));
+    return item.column >= 0 && item.column != COL_STATE;
+}
+
+// Parse SELECT <items> [WHERE c op v [AND ...]] [GROUP BY STATE] [ORDER BY x [ASC|DESC]]
+// [LIMIT n]. Words are separated by spaces (commas also separate select items).
+bool parseQuery(const string& input, Query& query, string& error) {
+    vector<string> words;
+    string current = "";
+    for (size_t i = 0; i <= input.length(); i++) {
+        if (i == input.length() || input[i] == ' ' || input[i] == ',') {
+            if (!current.empty()) words.push_back(current);
+            current = "";
+        } else {
+            current += input[i];
+        }
+    }
+    
+    // Select list runs up to the first clause keyword
+    size_t pos = 1;
+    while (pos < words.size()) {
+        string word = upperCase(words[pos]);
+        if (word == "WHERE" || word == "GROUP" || word == "ORDER" || word == "LIMIT") break;
+        
+        QueryItem item;
+        if (word == "*") {
+            query.allColumns = true;
+        } else if (parseQueryItem(word, item)) {
+            query.items.push_back(item);
+        } else {
+            error = "Unknown select item " + words[pos];
+            return false;
+        }
+        pos++;
+    }
+    if (!query.allColumns && query.items.empty()) {
+        error = "Nothing selected";
+        return false;
+    }
+    if (query.allColumns && !query.items.empty()) {
+        error = "* cannot be combined with other items";
+        return false;
+    }
+    
+    if (pos < words.size() && upperCase(words[pos]) == "WHERE") {
+        pos++;
+        while (true) {
+            if (pos + 3 > words.size()) {
+                error = "Incomplete WHERE condition";
+                return false;
+            }
+            
+            QueryFilter filter;
+            filter.column = queryColumn(upperCase(words[pos]));
+            if (filter.column < 0) {
+                error = "Unknown column " + words[pos];
+                return false;
+            }
+            
+            string op = words[pos + 1];
+            if (op == "=") filter.op = OP_EQ;
+            else if (op == "!=" || op == "<>") filter.op = OP_NE;
+            else if (op == "<") filter.op = OP_LT;
+            else if (op == "<=") filter.op = OP_LE;
+            else if (op == ">") filter.op = OP_GT;
+            else if (op == ">=") filter.op = OP_GE;
+            else {
+                error = "Unknown operator " + op;
+                return false;
+            }
+            
+            const string& value = words[pos + 2];
+            if (filter.column == COL_STATE) {
+                if (filter.op != OP_EQ && filter.op != OP_NE) {
+                    error = "STATE only supports = and !=";
+                    return false;
+                }
+                // State codes keep two characters, so anything longer would match a
+                // different state
+                string state = upperCase(value);
+                if (state.length() != 2 || state[0] < 'A' || state[0] > 'Z' || state[1] < 'A' || state[1] > 'Z') {
+                    error = "Invalid state " + value;
+                    return false;
+                }
+                filter.value = stateCode(state);
+            } else {
+                // Plain decimal numbers only; strtod would also take nan, inf and hex
+                if (value.find_first_not_of("0123456789+-.eE") != string::npos) {
+                    error = "Invalid value " + value;
+                    return false;
+                }
+                char* end = nullptr;
+                filter.value = strtod(value.c_str(), &end);
+                bool whole = filter.value == floor(filter.value) && fabs(filter.value) < 2e9;
+                if (*end != '\0' || !isfinite(filter.value) || (filter.column != COL_BALANCE && !whole)) {
+                    error = "Invalid value " + value;
+                    return false;
+                }
+            }
+            query.filters.push_back(filter);
+            pos += 3;
+            
+            if (pos < words.size() && upperCase(words[pos]) == "AND") pos++;
+            else break;
+        }
+    }
+    
+    if (pos < words.size() && upperCase(words[pos]) == "GROUP") {
+        if (pos + 2 >= words.size() || upperCase(words[pos + 1]) != "BY" ||
+            upperCase(words[pos + 2]) != "STATE") {
+            error = "Only GROUP BY STATE is supported";
+            return false;
+        }
+        query.groupByState = true;
+        pos += 3;
+    }
+    
+    if (pos < words.size() && upperCase(words[pos]) == "ORDER") {
+        if (pos + 2 >= words.size() || upperCase(words[pos + 1]) != "BY") {
+            error = "Incomplete ORDER BY";
+            return false;
+        }
+        
+        // Records are ordered by a column, aggregate results by one of the select items
+        string key = upperCase(words[pos + 2]);
+        if (key == "COUNT(*)") key = "COUNT";
+        if (query.allColumns) {
+            query.orderColumn = queryColumn(key);
+            if (query.orderColumn < 0 || query.orderColumn == COL_STATE) {
+                error = "Cannot order records by " + words[pos + 2];
+                return false;
+            }
+        } else {
+            for (size_t i = 0; i < query.items.size(); i++) {
+                if (query.items[i].label == key) query.orderItem = (int)i;
+            }
+            if (query.orderItem < 0) {
+                error = "ORDER BY must name a select item";
+                return false;
+            }
+        }
+        pos += 3;
+        
+        if (pos < words.size() && upperCase(words[pos]) == "DESC") {
+            query.descending = true;
+            pos++;
+        } else if (pos < words.size() && upperCase(words[pos]) == "ASC") {
+            pos++;
+        }
+    }
+    
+    if (pos < words.size() && upperCase(words[pos]) == "LIMIT") {
+        bool valid = pos + 1 < words.size() && !words[pos + 1].empty() && words[pos + 1].length() <= 18;
+        for (size_t i = 0; valid && i < words[pos + 1].length(); i++) {
+            if (words[pos + 1][i] < '0' || words[pos + 1][i] > '9') valid = false;
+        }
+        if (!valid) {
+            error = "LIMIT needs a number";
+            return false;
+        }
+        query.limit = stoll(words[pos + 1]);
+        pos += 2;
+    }
+    
+    if (pos < words.size()) {
+        error = "Unexpected " + words[pos];
+        return false;
+    }
+    
+    // STATE can only be shown next to aggregates when it is the group
+    for (size_t i = 0; i < query.items.size(); i++) {
+        if (query.items[i].function == ITEM_STATE && !query.groupByState) {
+            error = "STATE needs GROUP BY STATE";
+            return false;
+        }
+    }
+    if (query.allColumns && query.groupByState) {
+        error = "GROUP BY needs aggregates, not *";
+        return false;
+    }
+    return true;
+}
+
 // Display usage information
 void displayUsage(const string& programName) {
-    cout << "Usage: " << programName << " <database_file>" << endl;
+    cout << "Usage: " << programName << " [--lazy] <database_file>" << endl;
     cout << "Example: " << programName << " /home/subhajit/Desktop/Databases/database2025.txt" << endl;
     cout << "If no file specified, default path will be used." << endl;
+    cout << "--lazy loads only names and SSNs at startup; other fields are read on first use." << endl;
 }
 
 // Main program with command line arguments
 int main(int argc, char* argv[]) {
     string databaseFile;
+    bool lazyLoad = false;
+    
+    // Optional --lazy flag may appear before or after the file name
+    int fileArgs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--lazy") lazyLoad = true;
+        else if (fileArgs++ == 0) databaseFile = argv[i];
+    }
     
     // Handle command line arguments
-    if (argc == 2) {
-        databaseFile = argv[1];
+    if (fileArgs == 1) {
         cout << "Using specified database file: " << databaseFile << endl;
-    } else if (argc == 1) {
+    } else if (fileArgs == 0) {
         // Use default path if no arguments provided
         databaseFile = "/home/subhajit/Desktop/Databases/database2025.txt";
         cout << "No file specified. Using default: " << databaseFile << endl;
@@ -720,19 +2912,28 @@ int main(int argc, char* argv[]) {
     
     // Create database and load data
     PersonDatabase database;
-    if (!database.loadFromFile(databaseFile)) {
+    bool loaded;
+    if (lazyLoad) loaded = database.loadLazily(databaseFile);
+    else loaded = database.loadFromFile(databaseFile);
+    if (!loaded) {
         cout << "FATAL ERROR: Cannot load database. Exiting." << endl;
         return 1;
     }
     
     cout << endl << "Available Commands:" << endl;
     cout << "FIND [first] [last]    - Find specific person" << endl;
+    cout << "FINDSSN [ssn]          - Find person by SSN" << endl;
+    cout << "FUZZY [f] [l] [dist]   - Find closest names" << endl;
     cout << "FAMILY [last]          - Find all with last name" << endl;
     cout << "FIRST [first]          - Find all with first name" << endl;
     cout << "PRINT                  - Display all records" << endl;
     cout << "OLDEST                 - Find oldest person" << endl;
     cout << "SAVE                   - Save database to file" << endl;
+    cout << "SAVESTATUS             - Show progress of last save" << endl;
     cout << "RELOCATE [f] [l] [zip] - Update zip code" << endl;
+    cout << "UPDATESSN [f] [l] [s]  - Update SSN" << endl;
+    cout << "SELECT [query]         - Filter and aggregate" << endl;
+    cout << "CACHESTATS             - Show lookup cache hit rate" << endl;
     cout << "DELETE [f] [l]         - Remove person" << endl;
     cout << "VERIFY                 - Check tree balance" << endl;
     cout << "EXIT                   - Exit program" << endl;
@@ -743,7 +2944,11 @@ int main(int argc, char* argv[]) {
     // Main command loop
     while (true) {
         cout << endl << "Enter command > ";
-        getline(cin, userInput);
+        if (!getline(cin, userInput)) {
+            // End of input - let a running save finish before leaving
+            database.waitForBackgroundSave();
+            break;
+        }
         
         // Skip empty input
         if (userInput.empty()) {
@@ -767,6 +2972,31 @@ int main(int argc, char* argv[]) {
                 database.findPersonByName(arg1, arg2);
             }
         }
+        else if (command == "FINDSSN") {
+            if (arg1.empty()) {
+                cout << "USAGE: FINDSSN [ssn]" << endl;
+            } else {
+                database.findPersonBySSN(arg1);
+            }
+        }
+        else if (command == "FUZZY") {
+            // Optional third argument is the maximum edit distance (default 2)
+            int maxDistance = 2;
+            bool validDistance = true;
+            if (!arg3.empty()) {
+                validDistance = arg3.length() <= 2;
+                for (size_t i = 0; i < arg3.length(); i++) {
+                    if (arg3[i] < '0' || arg3[i] > '9') validDistance = false;
+                }
+                if (validDistance) maxDistance = stoi(arg3);
+            }
+            
+            if (arg1.empty() || arg2.empty() || !validDistance) {
+                cout << "USAGE: FUZZY [first name] [last name] [max distance]" << endl;
+            } else {
+                database.findPersonsByFuzzyName(arg1, arg2, maxDistance);
+            }
+        }
         else if (command == "FAMILY") {
             if (arg1.empty()) {
                 cout << "USAGE: FAMILY [last name]" << endl;
@@ -788,7 +3018,10 @@ int main(int argc, char* argv[]) {
             database.findOldestPersonInDatabase();
         }
         else if (command == "SAVE") {
-            database.saveToFile(databaseFile);
+            database.saveInBackground(databaseFile);
+        }
+        else if (command == "SAVESTATUS") {
+            database.reportSaveStatus();
         }
         else if (command == "RELOCATE") {
             if (arg1.empty() || arg2.empty() || arg3.empty()) {
@@ -797,6 +3030,13 @@ int main(int argc, char* argv[]) {
                 database.updatePersonZipCode(arg1, arg2, arg3);
             }
         }
+        else if (command == "UPDATESSN") {
+            if (arg1.empty() || arg2.empty() || arg3.empty()) {
+                cout << "USAGE: UPDATESSN [first] [last] [new ssn]" << endl;
+            } else {
+                database.updatePersonSSN(arg1, arg2, arg3);
+            }
+        }
         else if (command == "DELETE") {
             if (arg1.empty() || arg2.empty()) {
                 cout << "USAGE: DELETE [first] [last]" << endl;
@@ -804,13 +3044,31 @@ int main(int argc, char* argv[]) {
                 database.removePerson(arg1, arg2);
             }
         }
+        else if (command == "SELECT") {
+            Query query;
+            string error;
+            if (!parseQuery(userInput, query, error)) {
+                cout << "QUERY ERROR: " << error << endl;
+                cout << "USAGE: SELECT [*|items] [WHERE column op value AND ...] [GROUP BY STATE] "
+                     << "[ORDER BY item ASC|DESC] [LIMIT n]" << endl;
+            } else {
+                database.runQuery(query);
+            }
+        }
+        else if (command == "CACHESTATS") {
+            database.reportCacheStats();
+        }
         else if (command == "VERIFY") {
             database.verifyTreeBalance();
         }
         else if (command == "EXIT") {
-            cout << "Saving database and exiting. Goodbye!" << endl;
-            database.saveToFile(databaseFile);
-            break;
+            // Only leave once the records are safely on disk
+            cout << "Saving database before exiting..." << endl;
+            if (database.saveToFile(databaseFile)) {
+                cout << "Goodbye!" << endl;
+                break;
+            }
+            cout << "EXIT CANCELLED: Database was not saved" << endl;
         }
         else {
             cout << "UNKNOWN COMMAND: " << command << endl;